@@ -1,36 +1,98 @@
 #include "dynamicAllocator.h"
+#include "core/asserts.h"
 #include "core/systems/fmemory.h"
 #include "core/systems/logger.h"
 #include "helpers/freelist.h"
 
+// GE_MEMORY_DEBUG builds check the whole freelist before every operation so
+// corruption is caught right after the call that caused it
+#ifdef GE_MEMORY_DEBUG
+#define DYNA_ALLOC_VALIDATE(alloc)                                             \
+    FASSERT_MSG(freelistValidate(&(alloc)->list),                              \
+                "dynaAllocator freelist is corrupted.")
+#else
+#define DYNA_ALLOC_VALIDATE(alloc)
+#endif
+
 b8 dynaAllocCreate(u64 totalSize, u64* memoryRequirement, void* memory,
                    dynaAllocator* outAllocator) {
     // Get the memoryRequirement for the freelist
     u64 freelistReq = 0;
     freelistCreate(totalSize, &freelistReq, 0, 0);
 
-    *memoryRequirement = freelistReq + sizeof(dynaAllocator) + totalSize;
+    // Extra space so the block can be pushed up to an aligned address
+    *memoryRequirement = freelistReq + sizeof(dynaAllocator) + totalSize +
+                         DYNA_ALLOC_MAX_ALIGNMENT;
 
     if (!memory) {
         return true;
     }
 
-    outAllocator->freelistBlock = (void*)(memory + sizeof(dynaAllocator));
-    outAllocator->memoryBlock =
-        (void*)(outAllocator->freelistBlock + freelistReq);
+    void* freelistBlock = (void*)(memory + sizeof(dynaAllocator));
+    void* block = (void*)(((u64)(freelistBlock + freelistReq) +
+                           DYNA_ALLOC_MAX_ALIGNMENT - 1) &
+                          ~((u64)DYNA_ALLOC_MAX_ALIGNMENT - 1));
+    return dynaAllocCreateWithBlock(totalSize, &freelistReq, freelistBlock,
+                                    block, outAllocator);
+}
+
+b8 dynaAllocCreateWithBlock(u64 totalSize, u64* memoryRequirement,
+                            void* memory, void* block,
+                            dynaAllocator* outAllocator) {
+    freelistCreate(totalSize, memoryRequirement, 0, 0);
+    if (!memory) {
+        return true;
+    }
+    if ((u64)block & (DYNA_ALLOC_MAX_ALIGNMENT - 1)) {
+        FERROR("dynaAllocCreateWithBlock: block must be aligned to %u.",
+               DYNA_ALLOC_MAX_ALIGNMENT);
+        return false;
+    }
+
+    outAllocator->freelistBlock = memory;
+    outAllocator->memoryBlock = block;
     outAllocator->totalSize = totalSize;
 
-    freelistCreate(totalSize, &freelistReq, outAllocator->freelistBlock,
+    for (u32 i = 0; i < DYNA_ALLOC_BIN_COUNT; ++i) {
+        outAllocator->bins[i] = 0;
+    }
+    outAllocator->binMask = 0;
+    outAllocator->binnedSize = 0;
+
+    freelistCreate(totalSize, memoryRequirement, outAllocator->freelistBlock,
                    &outAllocator->list);
 
-    fzeroMemory(outAllocator->memoryBlock, totalSize);
+    // The block is NOT zeroed. Doing it would touch every page of the pool,
+    // fmalloc zeroes what it hands out instead.
+    return true;
+}
+
+b8 dynaAllocGrow(dynaAllocator* alloc, u64 newTotalSize,
+                 u64* memoryRequirement, void* newMemory,
+                 void** outOldMemory) {
+    DYNA_ALLOC_VALIDATE(alloc);
+    if (!newMemory) {
+        return freelistResize(&alloc->list, memoryRequirement, newTotalSize, 0,
+                              0);
+    }
+    if (!freelistResize(&alloc->list, memoryRequirement, newTotalSize,
+                        newMemory, outOldMemory)) {
+        FERROR("DynaAllocGrow failed to resize the freelist.");
+        return false;
+    }
+    alloc->freelistBlock = newMemory;
+    alloc->totalSize = newTotalSize;
     return true;
 }
 
 b8 dynaAllocDestroy(dynaAllocator* allocator) {
     if (allocator) {
         freelistDestroy(&allocator->list);
-        fzeroMemory(allocator->memoryBlock, allocator->totalSize);
+        for (u32 i = 0; i < DYNA_ALLOC_BIN_COUNT; ++i) {
+            allocator->bins[i] = 0;
+        }
+        allocator->binMask = 0;
+        allocator->binnedSize = 0;
         allocator->totalSize = 0;
         allocator->memoryBlock = 0;
         return true;
@@ -39,17 +101,81 @@ b8 dynaAllocDestroy(dynaAllocator* allocator) {
     return false;
 }
 
+u32 dynaAllocBinIndex(u64 size) {
+    if (size > DYNA_ALLOC_MAX_CLASS_SIZE) {
+        return INVALID_ID;
+    }
+    if (size <= 128) {
+        // 16 byte steps. A 0 byte request still takes the smallest class.
+        return size ? (u32)((size + 15) / 16 - 1) : 0;
+    }
+    // Past 128 bytes each power of two is split into 4 classes. So the
+    // wasted space is never more than 25% of the block.
+    u32 msb = 63 - __builtin_clzll(size - 1);
+    u32 sub = ((size - 1) >> (msb - 2)) & 3;
+    return 8 + (msb - 7) * 4 + sub;
+}
+
+u64 dynaAllocBinSize(u32 binIndex) {
+    if (binIndex < 8) {
+        return (binIndex + 1) * 16;
+    }
+    u64 base = 128ULL << ((binIndex - 8) / 4);
+    return base + (base / 4) * (((binIndex - 8) % 4) + 1);
+}
+
+// How much space a request of `size` really takes
+static u64 getBlockSize(u64 size) {
+    u32 bin = dynaAllocBinIndex(size);
+    if (bin != INVALID_ID) {
+        return dynaAllocBinSize(bin);
+    }
+    return (size + DYNA_ALLOC_GRANULARITY - 1) &
+           ~((u64)DYNA_ALLOC_GRANULARITY - 1);
+}
+
+b8 dynaAllocOwns(dynaAllocator* alloc, void* memory) {
+    return alloc && memory >= alloc->memoryBlock &&
+           memory < alloc->memoryBlock + alloc->totalSize;
+}
+
 void* dynaAlloc(dynaAllocator* alloc, u64 size) {
     if (alloc && size > 0) {
+        DYNA_ALLOC_VALIDATE(alloc);
+        u32 bin = dynaAllocBinIndex(size);
+        if (bin != INVALID_ID) {
+            // Fast path. Pop the head of the bin.
+            void* block = alloc->bins[bin];
+            if (block) {
+                alloc->bins[bin] = *(void**)block;
+                if (!alloc->bins[bin]) {
+                    alloc->binMask &= ~(1U << bin);
+                }
+                alloc->binnedSize -= dynaAllocBinSize(bin);
+                return block;
+            }
+        }
+        // Bin is empty or it's too big for one. Carve a whole class sized
+        // block from the freelist so it can be binned when freed.
+        size = getBlockSize(size);
+
         u64 offset = 0;
         if (freelistAllocateBlock(&alloc->list, size, &offset)) {
             return (void*)(alloc->memoryBlock + offset);
-        } else {
-            // TODO: Report some stuff about the dynaAllocator
-            // for easier debugging since the User is gonna be able to use this
-            FERROR("Failed to allocate with DynaAlloc.");
-            return 0;
         }
+
+        // The bins could be hoarding the space we need. Give it back to the
+        // freelist so it can be coalesced and try again.
+        if (alloc->binMask) {
+            dynaAllocFlushBins(alloc);
+            if (freelistAllocateBlock(&alloc->list, size, &offset)) {
+                return (void*)(alloc->memoryBlock + offset);
+            }
+        }
+
+        // Not an error by itself. The owner might grow the allocator.
+        FDEBUG("DynaAlloc is out of space for %llu bytes.", size);
+        return 0;
     }
 
     FERROR("DynaAlloc needs an allocator and a size above 0.");
@@ -57,7 +183,58 @@ void* dynaAlloc(dynaAllocator* alloc, u64 size) {
     return false;
 }
 
+void* dynaAllocAligned(dynaAllocator* alloc, u64 size, u64 alignment) {
+    if (alignment <= DYNA_ALLOC_GRANULARITY) {
+        // Every block is already this aligned
+        return dynaAlloc(alloc, size);
+    }
+    if (!alloc || size == 0 || alignment > DYNA_ALLOC_MAX_ALIGNMENT ||
+        (alignment & (alignment - 1)) != 0) {
+        FERROR("DynaAllocAligned needs an allocator, a size above 0 and a "
+               "power of 2 alignment up to %u.",
+               DYNA_ALLOC_MAX_ALIGNMENT);
+        return 0;
+    }
+
+    DYNA_ALLOC_VALIDATE(alloc);
+    // Take the same amount of space a normal allocation would so the block
+    // can go through the bins when it is freed.
+    size = getBlockSize(size);
+
+    u64 offset = 0;
+    if (freelistAllocateBlockAligned(&alloc->list, size, alignment, &offset)) {
+        return (void*)(alloc->memoryBlock + offset);
+    }
+    if (alloc->binMask) {
+        dynaAllocFlushBins(alloc);
+        if (freelistAllocateBlockAligned(&alloc->list, size, alignment,
+                                         &offset)) {
+            return (void*)(alloc->memoryBlock + offset);
+        }
+    }
+
+    FDEBUG("DynaAllocAligned is out of space for %llu bytes.", size);
+    return 0;
+}
+
 b8 dynaAllocFree(dynaAllocator* alloc, u64 size, void* memory) {
+    // Anything outside of the block was not allocated by us. Don't let it near
+    // the bins/freelist or it will corrupt them.
+    if (!dynaAllocOwns(alloc, memory)) {
+        return false;
+    }
+    DYNA_ALLOC_VALIDATE(alloc);
+
+    u32 bin = dynaAllocBinIndex(size);
+    if (bin != INVALID_ID) {
+        *(void**)memory = alloc->bins[bin];
+        alloc->bins[bin] = memory;
+        alloc->binMask |= 1U << bin;
+        alloc->binnedSize += dynaAllocBinSize(bin);
+        return true;
+    }
+
+    size = getBlockSize(size);
     u64 offset = memory - alloc->memoryBlock;
     if (!freelistFreeBlock(&alloc->list, size, offset)) {
         FERROR("DynaAllocFree failed to free block.");
@@ -66,6 +243,52 @@ b8 dynaAllocFree(dynaAllocator* alloc, u64 size, void* memory) {
     return true;
 }
 
+b8 dynaAllocResize(dynaAllocator* alloc, void* memory, u64 oldSize,
+                   u64 newSize) {
+    if (!dynaAllocOwns(alloc, memory) || newSize == 0) {
+        return false;
+    }
+    DYNA_ALLOC_VALIDATE(alloc);
+
+    u64 oldBlockSize = getBlockSize(oldSize);
+    u64 newBlockSize = getBlockSize(newSize);
+    if (newBlockSize == oldBlockSize) {
+        return true;
+    }
+
+    u64 offset = memory - alloc->memoryBlock;
+    if (newBlockSize < oldBlockSize) {
+        // Give the tail back
+        return freelistFreeBlock(&alloc->list, oldBlockSize - newBlockSize,
+                                 offset + newBlockSize);
+    }
+    return freelistAllocateBlockAt(&alloc->list, newBlockSize - oldBlockSize,
+                                   offset + oldBlockSize);
+}
+
+void dynaAllocFlushBins(dynaAllocator* alloc) {
+    DYNA_ALLOC_VALIDATE(alloc);
+    u32 mask = alloc->binMask;
+    while (mask) {
+        u32 bin = __builtin_ctz(mask);
+        mask &= mask - 1;
+
+        u64 binSize = dynaAllocBinSize(bin);
+        void* block = alloc->bins[bin];
+        while (block) {
+            void* next = *(void**)block;
+            if (!freelistFreeBlock(&alloc->list, binSize,
+                                   block - alloc->memoryBlock)) {
+                FERROR("DynaAllocFlushBins failed to return a block.");
+            }
+            block = next;
+        }
+        alloc->bins[bin] = 0;
+    }
+    alloc->binMask = 0;
+    alloc->binnedSize = 0;
+}
+
 u64 dynaAllocFreeSpace(dynaAllocator* alloc) {
-    return freelistFreeSpace(&alloc->list);
+    return freelistFreeSpace(&alloc->list) + alloc->binnedSize;
 }
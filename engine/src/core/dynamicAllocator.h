@@ -4,23 +4,99 @@
 #include "helpers/freelist.h"
 
 /*
- * Pretty much a wrapper to a free list
+ * Pretty much a wrapper to a free list. Small allocations are served from
+ * segregated size-class bins so they never have to walk the freelist.
  */
 
+// Smallest/largest request that gets served from a size-class bin. Anything
+// above DYNA_ALLOC_MAX_CLASS_SIZE goes straight to the freelist.
+#define DYNA_ALLOC_MIN_CLASS_SIZE 16
+#define DYNA_ALLOC_MAX_CLASS_SIZE 4096
+// 8 linear classes (16..128) + 4 sub-classes for each power of two up to 4KiB
+#define DYNA_ALLOC_BIN_COUNT 28
+// Blocks too big for a bin are rounded to this. Keeps every block aligned.
+#define DYNA_ALLOC_GRANULARITY 16
+// The start of the managed block is aligned to this, so `dynaAllocAligned`
+// can align offsets instead of addresses. Largest alignment supported.
+#define DYNA_ALLOC_MAX_ALIGNMENT 4096
+
 typedef struct dynaAllocator {
     u64 totalSize;
     freelist list;
     void* freelistBlock;
     void* memoryBlock;
+    // Intrusive singly linked lists of freed small blocks, one per size class.
+    // The first 8 bytes of a binned block point to the next block.
+    void* bins[DYNA_ALLOC_BIN_COUNT];
+    // Bit N is set when bins[N] has at least one block in it
+    u32 binMask;
+    // Bytes sitting in the bins. Counted as free space.
+    u64 binnedSize;
 } dynaAllocator;
 
 b8 dynaAllocCreate(u64 totalSize, u64* memoryRequirement, void* memory,
                    dynaAllocator* outAllocator);
 
+/**
+ * @brief Same as `dynaAllocCreate` but the managed block lives somewhere else
+ * (e.g. a reserved range). `memory` only holds the freelist.
+ * @param block Start of the managed block, aligned to DYNA_ALLOC_MAX_ALIGNMENT
+ */
+b8 dynaAllocCreateWithBlock(u64 totalSize, u64* memoryRequirement,
+                            void* memory, void* block,
+                            dynaAllocator* outAllocator);
+
+/**
+ * @brief Grows an allocator made with `dynaAllocCreateWithBlock` to
+ * `newTotalSize`. The block has to have room for it already. Works like
+ * `freelistResize`, call it with `newMemory` 0 first to get the requirement.
+ * @param outOldMemory The old freelist memory, free it after this returns
+ */
+b8 dynaAllocGrow(dynaAllocator* alloc, u64 newTotalSize,
+                 u64* memoryRequirement, void* newMemory,
+                 void** outOldMemory);
+
 b8 dynaAllocDestroy(dynaAllocator* allocator);
 
 void* dynaAlloc(dynaAllocator* alloc, u64 size);
 
+/**
+ * @brief Allocates a block aligned to `alignment` (power of 2, up to
+ * DYNA_ALLOC_MAX_ALIGNMENT). Free it with `dynaAllocFree` like any other block.
+ */
+void* dynaAllocAligned(dynaAllocator* alloc, u64 size, u64 alignment);
+
 b8 dynaAllocFree(dynaAllocator* alloc, u64 size, void* memory);
 
+/**
+ * @brief Tries to resize a block without moving it. Shrinking always works,
+ * growing works if the space right after the block is free in the freelist.
+ * @param oldSize The size the block was allocated/last resized with
+ * @returns true if the block is now `newSize`, false if it has to be moved
+ */
+b8 dynaAllocResize(dynaAllocator* alloc, void* memory, u64 oldSize,
+                   u64 newSize);
+
+/**
+ * @brief True if `memory` is inside the allocator's block
+ */
+b8 dynaAllocOwns(dynaAllocator* alloc, void* memory);
+
+/**
+ * @brief Returns every binned block back to the freelist so it can be
+ * coalesced. Called automatically when the freelist runs dry.
+ */
+void dynaAllocFlushBins(dynaAllocator* alloc);
+
 u64 dynaAllocFreeSpace(dynaAllocator* alloc);
+
+/**
+ * @brief Gets the size-class bin a request of `size` bytes falls into.
+ * @returns The bin index, INVALID_ID if `size` is too big for a bin.
+ */
+u32 dynaAllocBinIndex(u64 size);
+
+/**
+ * @brief Gets the actual block size handed out for a size-class bin.
+ */
+u64 dynaAllocBinSize(u32 binIndex);
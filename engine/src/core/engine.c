@@ -1,30 +1,51 @@
 #include "engine.h"
+#include "core/linearAllocator.h"
+#include "core/systems/event.h"
 #include "core/systems/fmemory.h"
 #include "core/systems/logger.h"
+#include "core/systems/stringTable.h"
 #include "core/systemsManager.h"
 #include "defines.h"
 #include "gameInfo.h"
 #include "platform/platform.h"
 
+// Size of the scratch memory that is thrown away every frame
+#define ENGINE_FRAME_ALLOCATOR_SIZE MEBIBYTES(8)
+
 typedef struct EngineInfo {
     GameInfo* gameInfo;
     b8 isRunning;
     SystemsInfo systemsInfo;
+    stringId appName;
+    // Reset at the top of every frame
+    linearAllocator frameAllocator;
 } EngineInfo;
 
 static EngineInfo* systemPtr;
 
 b8 engineStart(GameInfo* gameInfo) {
     FINFO("Started Engine.");
-    systemPtr = fmalloc(sizeof(EngineInfo), MEMORY_TAG_APPLICATION);
 
+    // Memory system has to be up before anything else is allocated
+    // Starts small and grows into the reserved range when it runs out
     MemorySystemSettings memorySettings;
-    memorySettings.totalSize = GIBIBYTES(1);
+    memorySettings.totalSize = MEBIBYTES(64);
+    memorySettings.reserveSize = FMEMORY_DEFAULT_RESERVE_SIZE;
     memoryInit(memorySettings);
 
+    systemPtr = fmalloc(sizeof(EngineInfo), MEMORY_TAG_APPLICATION);
+    systemPtr->gameInfo = gameInfo;
+
+    if (!linearAllocCreate(ENGINE_FRAME_ALLOCATOR_SIZE, 0,
+                           &systemPtr->frameAllocator)) {
+        FFATAL("Failed to create the frame allocator.");
+        return false;
+    }
+
     systemsInit(&systemPtr->systemsInfo);
 
-    platformStartup(gameInfo->appName, gameInfo->x, gameInfo->y, gameInfo->width, gameInfo->height);
+    systemPtr->appName = stringIntern(gameInfo->appName);
+    platformStartup(stringGet(systemPtr->appName), gameInfo->x, gameInfo->y, gameInfo->width, gameInfo->height);
 
     printMemoryUsage();
     systemPtr->isRunning = true;
@@ -34,15 +55,30 @@ b8 engineStart(GameInfo* gameInfo) {
 
 b8 engineRun(GameInfo* gameInfo) {
     while (systemPtr->isRunning) {
+        // Last frame's scratch memory is dead now
+        linearAllocReset(&systemPtr->frameAllocator);
+        memoryFrameEnd();
+        eventFrameEnd();
+        loggerFlush();
+
         if (!platformPumpMessages()) {
             systemPtr->isRunning = false;
         }
+        // Fires what the platform posted while pumping
+        eventDispatchQueued();
     }
     return true;
 }
 
 b8 engineDestroy(GameInfo* gameInfo) {
     systemsShutdown(&systemPtr->systemsInfo);
+    linearAllocDestroy(&systemPtr->frameAllocator);
+    ffree(systemPtr);
+    systemPtr = 0;
     memoryShutdown();
     return true;
 }
+
+void* engineFrameAlloc(u64 size) {
+    return linearAlloc(&systemPtr->frameAllocator, size);
+}
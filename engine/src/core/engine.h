@@ -6,3 +6,12 @@
 b8 engineStart(GameInfo* gameInfo);
 b8 engineRun(GameInfo* gameInfo);
 b8 engineDestroy(GameInfo* gameInfo);
+
+/**
+ * @brief Allocates scratch memory that is only valid until the end of the
+ * current frame. Never free it, it is reset at the top of the next frame.
+ * The memory is NOT zeroed.
+ * @param size Size of the block needed
+ * @returns pointer to the block, 0 if the frame's scratch memory is used up
+ */
+CT_API void* engineFrameAlloc(u64 size);
@@ -0,0 +1,64 @@
+#include "linearAllocator.h"
+#include "core/systems/fmemory.h"
+#include "core/systems/logger.h"
+
+// Every allocation starts on this boundary so SIMD types can be put in it
+#define LINEAR_ALLOC_ALIGNMENT 16
+
+b8 linearAllocCreate(u64 totalSize, void* memory,
+                     linearAllocator* outAllocator) {
+    if (!outAllocator || totalSize == 0) {
+        FERROR("linearAllocCreate needs an allocator and a size above 0.");
+        return false;
+    }
+
+    outAllocator->totalSize = totalSize;
+    outAllocator->allocated = 0;
+    outAllocator->ownsMemory = memory == 0;
+    if (memory) {
+        outAllocator->memory = memory;
+    } else {
+        // Scratch memory. No point zeroing it
+        outAllocator->memory = fmallocEx(totalSize, MEMORY_TAG_ALLOCATORS,
+                                         FMALLOC_FLAG_NO_ZERO);
+    }
+    return outAllocator->memory != 0;
+}
+
+void linearAllocDestroy(linearAllocator* allocator) {
+    if (!allocator) {
+        return;
+    }
+    if (allocator->ownsMemory && allocator->memory) {
+        ffree(allocator->memory);
+    }
+    allocator->memory = 0;
+    allocator->totalSize = 0;
+    allocator->allocated = 0;
+    allocator->ownsMemory = false;
+}
+
+void* linearAlloc(linearAllocator* allocator, u64 size) {
+    if (!allocator || !allocator->memory) {
+        FERROR("linearAlloc called on an allocator that wasn't created.");
+        return 0;
+    }
+
+    u64 offset = (allocator->allocated + (LINEAR_ALLOC_ALIGNMENT - 1)) &
+                 ~((u64)LINEAR_ALLOC_ALIGNMENT - 1);
+    if (offset + size > allocator->totalSize) {
+        FERROR("linearAlloc out of space (requested: %lluB, remaining: "
+               "%lluB).",
+               size, allocator->totalSize - allocator->allocated);
+        return 0;
+    }
+
+    allocator->allocated = offset + size;
+    return allocator->memory + offset;
+}
+
+void linearAllocReset(linearAllocator* allocator) {
+    if (allocator) {
+        allocator->allocated = 0;
+    }
+}
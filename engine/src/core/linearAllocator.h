@@ -0,0 +1,42 @@
+#pragma once
+
+#include "defines.h"
+
+/*
+ * Bump allocator. Allocating moves a pointer forward, there is no per
+ * allocation free. Everything is given back at once with `linearAllocReset`.
+ * Good for data that only has to live for a frame/load/etc.
+ */
+
+typedef struct linearAllocator {
+    u64 totalSize;
+    u64 allocated;
+    void* memory;
+    // True if the memory was allocated by `linearAllocCreate`
+    b8 ownsMemory;
+} linearAllocator;
+
+/**
+ * @brief Creates a linear allocator.
+ * @param totalSize Size of the block the allocator hands out from
+ * @param memory Block to use. If 0 a block is allocated from the memory system
+ * and freed on `linearAllocDestroy`
+ * @param outAllocator The allocator to set up
+ * @returns true if successful, false if failed
+ */
+b8 linearAllocCreate(u64 totalSize, void* memory,
+                     linearAllocator* outAllocator);
+
+void linearAllocDestroy(linearAllocator* allocator);
+
+/**
+ * @brief Allocates from the allocator. The memory is NOT zeroed and is 16 byte
+ * aligned.
+ * @returns pointer to the block, 0 if the allocator is out of space
+ */
+void* linearAlloc(linearAllocator* allocator, u64 size);
+
+/**
+ * @brief Frees everything allocated so far.
+ */
+void linearAllocReset(linearAllocator* allocator);
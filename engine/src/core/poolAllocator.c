@@ -0,0 +1,145 @@
+#include "poolAllocator.h"
+#include "core/systems/logger.h"
+#include "helpers/dinoarray.h"
+
+static PoolHandle makeHandle(u32 index, u16 generation) {
+    return ((u32)(generation & POOL_HANDLE_GENERATION_MASK)
+            << POOL_HANDLE_INDEX_BITS) |
+           index;
+}
+
+static void* slotElement(poolAllocator* pool, u32 index) {
+    void* slab = pool->slabs[index / pool->elementsPerSlab];
+    return slab + (u64)(index % pool->elementsPerSlab) * pool->elementSize;
+}
+
+static b8 addSlab(poolAllocator* pool) {
+    if ((u64)pool->capacity + pool->elementsPerSlab > POOL_MAX_ELEMENTS) {
+        FERROR("Pool is full (%u elements).", pool->capacity);
+        return false;
+    }
+
+    // Elements are zeroed when handed out
+    void* slab = fmallocEx(pool->elementSize * pool->elementsPerSlab,
+                           pool->tag, FMALLOC_FLAG_NO_ZERO);
+    if (!slab) {
+        return false;
+    }
+    dinoPush(pool->slabs, slab);
+
+    // Push the new indices backwards so the lowest one is handed out first
+    u32 first = pool->capacity;
+    pool->capacity += pool->elementsPerSlab;
+    if (!bitsetResize(&pool->alive, pool->capacity)) {
+        pool->capacity = first;
+        dinoPop(pool->slabs, &slab);
+        ffree(slab);
+        return false;
+    }
+    for (u32 i = first; i < pool->capacity; ++i) {
+        dinoPush(pool->generations, (u16)0);
+    }
+    for (u32 i = pool->capacity; i > first; --i) {
+        dinoPush(pool->freeIndices, i - 1);
+    }
+    return true;
+}
+
+b8 poolAllocCreate(u64 elementSize, u32 elementsPerSlab, MemoryTag tag,
+                   poolAllocator* outPool) {
+    if (!outPool || elementSize == 0 || elementsPerSlab == 0) {
+        FERROR("poolAllocCreate needs a pool, element size and slab size.");
+        return false;
+    }
+
+    // Keep every element pointer aligned
+    outPool->elementSize = (elementSize + 7) & ~7ULL;
+    outPool->elementsPerSlab = elementsPerSlab;
+    outPool->capacity = 0;
+    outPool->count = 0;
+    outPool->tag = tag;
+    outPool->slabs = dinoCreate(void*);
+    outPool->generations = dinoCreateReserve(elementsPerSlab, u16);
+    outPool->freeIndices = dinoCreateReserve(elementsPerSlab, u32);
+    // Sized as slabs are added
+    return bitsetCreate(0, &outPool->alive);
+}
+
+void poolAllocDestroy(poolAllocator* pool) {
+    if (!pool || !pool->slabs) {
+        return;
+    }
+    u64 slabCount = dinoLength(pool->slabs);
+    for (u64 i = 0; i < slabCount; ++i) {
+        ffree(pool->slabs[i]);
+    }
+    dinoDestroy(pool->slabs);
+    dinoDestroy(pool->generations);
+    dinoDestroy(pool->freeIndices);
+    bitsetDestroy(&pool->alive);
+    pool->slabs = 0;
+    pool->generations = 0;
+    pool->freeIndices = 0;
+    pool->capacity = 0;
+    pool->count = 0;
+}
+
+PoolHandle poolAlloc(poolAllocator* pool, void** outElement) {
+    if (dinoLength(pool->freeIndices) == 0 && !addSlab(pool)) {
+        return POOL_HANDLE_INVALID;
+    }
+
+    u32 index;
+    dinoPop(pool->freeIndices, &index);
+    bitsSet(pool->alive.words, index);
+    pool->count++;
+
+    void* element = slotElement(pool, index);
+    fzeroMemory(element, pool->elementSize);
+    if (outElement) {
+        *outElement = element;
+    }
+    return makeHandle(index, pool->generations[index]);
+}
+
+b8 poolFree(poolAllocator* pool, PoolHandle handle) {
+    if (!poolGet(pool, handle)) {
+        FWARN("poolFree called with a stale handle.");
+        return false;
+    }
+
+    u32 index = handle & POOL_HANDLE_INDEX_MASK;
+    bitsClear(pool->alive.words, index);
+    pool->generations[index] =
+        (pool->generations[index] + 1) & POOL_HANDLE_GENERATION_MASK;
+    pool->count--;
+    dinoPush(pool->freeIndices, index);
+    return true;
+}
+
+void* poolGet(poolAllocator* pool, PoolHandle handle) {
+    u32 index = handle & POOL_HANDLE_INDEX_MASK;
+    if (handle == POOL_HANDLE_INVALID || index >= pool->capacity) {
+        return 0;
+    }
+    u16 generation = handle >> POOL_HANDLE_INDEX_BITS;
+    if (!bitsTest(pool->alive.words, index) ||
+        pool->generations[index] != generation) {
+        return 0;
+    }
+    return slotElement(pool, index);
+}
+
+void* poolIterate(poolAllocator* pool, u32* iterator, PoolHandle* outHandle) {
+    // Skips 64 dead slots per word
+    u64 i = bitsetFindFirstSet(&pool->alive, *iterator);
+    if (i == BITSET_NOT_FOUND) {
+        *iterator = pool->capacity;
+        return 0;
+    }
+    *iterator = (u32)i + 1;
+    if (outHandle) {
+        *outHandle = makeHandle((u32)i, pool->generations[i]);
+    }
+    return slotElement(pool, (u32)i);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "core/systems/fmemory.h"
+#include "defines.h"
+#include "helpers/bitset.h"
+
+/*
+ * Fixed size object pool. Elements live in slabs that never move, so a pointer
+ * from `poolGet` stays good until the element is freed. Instead of pointers the
+ * pool hands out handles. The low POOL_HANDLE_INDEX_BITS bits of a handle are
+ * the slot index and the rest is the slot's generation, which is bumped every
+ * time the slot is freed so stale handles stop resolving.
+ */
+
+typedef u32 PoolHandle;
+
+#define POOL_HANDLE_INDEX_BITS 20
+#define POOL_HANDLE_INDEX_MASK ((1U << POOL_HANDLE_INDEX_BITS) - 1)
+#define POOL_HANDLE_GENERATION_MASK ((1U << (32 - POOL_HANDLE_INDEX_BITS)) - 1)
+// The last index is never handed out so a valid handle can't be INVALID_ID
+#define POOL_MAX_ELEMENTS POOL_HANDLE_INDEX_MASK
+#define POOL_HANDLE_INVALID INVALID_ID
+
+typedef struct poolAllocator {
+    u64 elementSize;
+    u32 elementsPerSlab;
+    // Slots across all slabs
+    u32 capacity;
+    // Live elements
+    u32 count;
+    // Tag the slabs are allocated with
+    MemoryTag tag;
+    // DinoArray of slab pointers
+    void** slabs;
+    // DinoArray with each slot's generation
+    u16* generations;
+    // Bit per slot, set while the slot's element is alive
+    bitset alive;
+    // DinoArray used as a stack of free slot indices
+    u32* freeIndices;
+} poolAllocator;
+
+/**
+ * @brief Creates a pool. No slabs are allocated until the first `poolAlloc`.
+ * @param elementSize Size of a single element
+ * @param elementsPerSlab How many elements are allocated at a time
+ * @param tag Memory tag the slabs are counted under
+ * @param outPool The pool to set up
+ * @returns true if successful, false if failed
+ */
+b8 poolAllocCreate(u64 elementSize, u32 elementsPerSlab, MemoryTag tag,
+                   poolAllocator* outPool);
+
+void poolAllocDestroy(poolAllocator* pool);
+
+/**
+ * @brief Allocates a zeroed element.
+ * @param outElement Optional. Set to the element's memory
+ * @returns a handle to the element, POOL_HANDLE_INVALID if the pool is full
+ */
+PoolHandle poolAlloc(poolAllocator* pool, void** outElement);
+
+/**
+ * @brief Frees an element. Every handle to it goes stale.
+ * @returns false if the handle was already stale
+ */
+b8 poolFree(poolAllocator* pool, PoolHandle handle);
+
+/**
+ * @brief Gets an element from its handle.
+ * @returns pointer to the element, 0 if the handle is stale
+ */
+void* poolGet(poolAllocator* pool, PoolHandle handle);
+
+/**
+ * @brief Walks the live elements in slot order. Start `iterator` at 0 and call
+ * until it returns 0.
+ * @param iterator In/out slot index to continue from
+ * @param outHandle Optional. Set to the returned element's handle
+ * @returns the next live element, 0 when there are no more
+ */
+void* poolIterate(poolAllocator* pool, u32* iterator, PoolHandle* outHandle);
@@ -0,0 +1,109 @@
+#include "stackAllocator.h"
+#include "core/systems/fmemory.h"
+#include "core/systems/logger.h"
+
+// Every allocation starts on this boundary so SIMD types can be put in it
+#define STACK_ALLOC_ALIGNMENT 16
+
+b8 stackAllocCreate(u64 totalSize, void* memory, stackAllocator* outAllocator) {
+    if (!outAllocator || totalSize == 0) {
+        FERROR("stackAllocCreate needs an allocator and a size above 0.");
+        return false;
+    }
+
+    outAllocator->totalSize = totalSize;
+    outAllocator->bottom = 0;
+    outAllocator->top = totalSize;
+    outAllocator->ownsMemory = memory == 0;
+    if (memory) {
+        outAllocator->memory = memory;
+    } else {
+        outAllocator->memory = fmallocEx(totalSize, MEMORY_TAG_ALLOCATORS,
+                                         FMALLOC_FLAG_NO_ZERO);
+    }
+    return outAllocator->memory != 0;
+}
+
+void stackAllocDestroy(stackAllocator* allocator) {
+    if (!allocator) {
+        return;
+    }
+    if (allocator->ownsMemory && allocator->memory) {
+        ffree(allocator->memory);
+    }
+    allocator->memory = 0;
+    allocator->totalSize = 0;
+    allocator->bottom = 0;
+    allocator->top = 0;
+    allocator->ownsMemory = false;
+}
+
+void* stackAlloc(stackAllocator* allocator, u64 size) {
+    if (!allocator || !allocator->memory) {
+        FERROR("stackAlloc called on an allocator that wasn't created.");
+        return 0;
+    }
+
+    u64 offset = (allocator->bottom + (STACK_ALLOC_ALIGNMENT - 1)) &
+                 ~((u64)STACK_ALLOC_ALIGNMENT - 1);
+    if (offset > allocator->top || size > allocator->top - offset) {
+        FERROR("stackAlloc out of space (requested: %lluB, remaining: %lluB).",
+               size, allocator->top - allocator->bottom);
+        return 0;
+    }
+
+    allocator->bottom = offset + size;
+    return allocator->memory + offset;
+}
+
+void* stackAllocTop(stackAllocator* allocator, u64 size) {
+    if (!allocator || !allocator->memory) {
+        FERROR("stackAllocTop called on an allocator that wasn't created.");
+        return 0;
+    }
+
+    // Round down so the block start stays aligned
+    u64 offset = (allocator->top - size) & ~((u64)STACK_ALLOC_ALIGNMENT - 1);
+    if (size > allocator->top || offset < allocator->bottom) {
+        FERROR("stackAllocTop out of space (requested: %lluB, remaining: "
+               "%lluB).",
+               size, allocator->top - allocator->bottom);
+        return 0;
+    }
+
+    allocator->top = offset;
+    return allocator->memory + offset;
+}
+
+stackMarker stackAllocGetMarker(stackAllocator* allocator) {
+    return allocator->bottom;
+}
+
+stackMarker stackAllocGetTopMarker(stackAllocator* allocator) {
+    return allocator->top;
+}
+
+void stackAllocFreeToMarker(stackAllocator* allocator, stackMarker marker) {
+    if (marker > allocator->bottom) {
+        FERROR("stackAllocFreeToMarker: marker is past the bottom end. Freed "
+               "out of order?");
+        return;
+    }
+    allocator->bottom = marker;
+}
+
+void stackAllocFreeToTopMarker(stackAllocator* allocator, stackMarker marker) {
+    if (marker < allocator->top || marker > allocator->totalSize) {
+        FERROR("stackAllocFreeToTopMarker: marker is past the top end. Freed "
+               "out of order?");
+        return;
+    }
+    allocator->top = marker;
+}
+
+void stackAllocReset(stackAllocator* allocator) {
+    if (allocator) {
+        allocator->bottom = 0;
+        allocator->top = allocator->totalSize;
+    }
+}
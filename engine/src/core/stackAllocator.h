@@ -0,0 +1,70 @@
+#pragma once
+
+#include "defines.h"
+
+/*
+ * Double-ended stack allocator. One block, allocations grow up from the bottom
+ * and down from the top. Nothing is freed on its own, grab a marker before a
+ * scope and free back to it after. Good for LIFO lifetimes like startup
+ * memory, level loading or nested temporary buffers, e.g. level data from the
+ * bottom and the loader's scratch from the top.
+ */
+
+// Position of one end of the stack. Freeing to it gives back everything that
+// end allocated after it was taken.
+typedef u64 stackMarker;
+
+typedef struct stackAllocator {
+    u64 totalSize;
+    // Offset the bottom end has allocated up to
+    u64 bottom;
+    // Offset the top end has allocated down to
+    u64 top;
+    void* memory;
+    // True if the memory was allocated by `stackAllocCreate`
+    b8 ownsMemory;
+} stackAllocator;
+
+/**
+ * @brief Creates a stack allocator.
+ * @param totalSize Size of the block both ends share
+ * @param memory Block to use. If 0 a block is allocated from the memory system
+ * and freed on `stackAllocDestroy`
+ * @param outAllocator The allocator to set up
+ * @returns true if successful, false if failed
+ */
+b8 stackAllocCreate(u64 totalSize, void* memory, stackAllocator* outAllocator);
+
+void stackAllocDestroy(stackAllocator* allocator);
+
+/**
+ * @brief Allocates from the bottom end. The memory is NOT zeroed and is 16
+ * byte aligned.
+ * @returns pointer to the block, 0 if the ends would cross
+ */
+void* stackAlloc(stackAllocator* allocator, u64 size);
+
+/**
+ * @brief Same as `stackAlloc` but from the top end
+ */
+void* stackAllocTop(stackAllocator* allocator, u64 size);
+
+stackMarker stackAllocGetMarker(stackAllocator* allocator);
+
+stackMarker stackAllocGetTopMarker(stackAllocator* allocator);
+
+/**
+ * @brief Frees everything the bottom end allocated after `marker` was taken.
+ * Markers have to be freed in reverse order.
+ */
+void stackAllocFreeToMarker(stackAllocator* allocator, stackMarker marker);
+
+/**
+ * @brief Same as `stackAllocFreeToMarker` but for the top end
+ */
+void stackAllocFreeToTopMarker(stackAllocator* allocator, stackMarker marker);
+
+/**
+ * @brief Frees everything from both ends.
+ */
+void stackAllocReset(stackAllocator* allocator);
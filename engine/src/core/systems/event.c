@@ -1,78 +1,526 @@
 #include "core/systems/event.h"
+#include "core/systems/fmemory.h"
 #include "core/systems/logger.h"
+#include "core/systems/stringTable.h"
 #include "helpers/dinoarray.h"
+#include "helpers/hashmap.h"
+#include "helpers/ringQueue.h"
+#include "helpers/slotmap.h"
+
+#include <string.h>
+
+#ifdef GE_EVENT_INSTRUMENTATION
+#include "platform/filesystem.h"
+#include "platform/platform.h"
+
+#include <stdio.h>
+
+// Trace records kept before the oldest are overwritten. ~2.5MiB
+#define EVENT_TRACE_CAPACITY 65536
+#define EVENT_TRACE_MAGIC "GEET"
+#define EVENT_TRACE_VERSION 1
+#endif
 
 typedef struct RegisteredEventPairing {
     void* listener;
+    // 0 once unsubscribed. Skipped until the range is compacted
     PF_OnEvent functionCallback;
+    // EventListenerFlags
+    u32 flags;
+    i32 priority;
+    EventSubscription subscription;
+#ifdef GE_EVENT_INSTRUMENTATION
+    EventStats stats;
+#endif
 } RegisteredEventPairing;
 
+DINO_DEFINE(RegisteredEventPairing)
+
+// An event waiting in the queue for `eventDispatchQueued`
+typedef struct QueuedEvent {
+    void* sender;
+    EventContext context;
+    // Next queued event with the same code, INVALID_ID if it's the last
+    u32 next;
+} QueuedEvent;
+
+DINO_DEFINE(QueuedEvent)
+
+// Every code that has queued events, in the order they were first posted.
+// Its events are chained from `first` to `last` through `QueuedEvent.next`
+typedef struct QueuedCode {
+    u16 code;
+    u32 first;
+    u32 last;
+} QueuedCode;
+
+DINO_DEFINE(QueuedCode)
+
+// An event posted from another thread with `eventPostFromThread`
+typedef struct InboxEvent {
+    u16 code;
+    void* sender;
+    EventContext context;
+} InboxEvent;
+
+// Events other threads can post between 2 dispatches
+#define EVENT_INBOX_CAPACITY 4096
+
 typedef struct EventCodeEntry {
-    RegisteredEventPairing* events;
+    // This code's listeners are listeners[first, first + count) in the pool.
+    // The range can hold `capacity` before it has to move
+    u32 first;
+    u32 count;
+    u32 capacity;
+    // Index into the posting queue's `codes`, INVALID_ID if nothing is queued
+    u32 queuedCode;
+    // Unsubscribed listeners still in the range
+    u32 tombstones;
+    // Only the last posted event of this code is kept each frame
+    b8 coalesce;
+#ifdef GE_EVENT_INSTRUMENTATION
+    // Every fire of this code
+    EventStats stats;
+    // Interned name for codes from `eventGetCode`, STRING_ID_INVALID if none
+    stringId name;
+#endif
 } EventCodeEntry;
 
-// NOTE-BUG: May need to up this number
-#define MAX_MESSAGE_CODES 10000
+// What a subscription handle points to. `offset` is relative to the range's
+// `first` so moving the range doesn't touch it
+typedef struct EventSubscriptionRecord {
+    u16 code;
+    u32 offset;
+} EventSubscriptionRecord;
+
+// A fire in progress. Inserting before `index` bumps it so the loop doesn't
+// call the same listener twice
+typedef struct ActiveFire {
+    u16 code;
+    u32 index;
+} ActiveFire;
+
+// Listeners can fire events from their callbacks this deep
+#define EVENT_MAX_FIRE_DEPTH 16
+
+DINO_DEFINE(EventCodeEntry)
+
+// Listener slots a code gets the first time it's registered to
+#define EVENT_LISTENER_RANGE_MIN 4
+// The pool is compacted once this many slots are left behind by moved ranges
+#define EVENT_LISTENER_COMPACT_MIN 256
+
+// Events posted during a frame. There are 2 so listeners can post while the
+// other one is being dispatched
+typedef struct EventQueue {
+    QueuedEvent* events;
+    QueuedCode* codes;
+} EventQueue;
 
-// Array of registered events
 typedef struct EventSystemState {
-    EventCodeEntry registered[MAX_MESSAGE_CODES];
+    // Entries for the systemEventCode codes, indexed by code
+    EventCodeEntry systemCodes[EVENT_CODE_MAX_TAGS];
+    // DinoArray of entries for codes from `eventGetCode`, indexed by
+    // code - EVENT_CODE_MAX_TAGS
+    EventCodeEntry* userCodes;
+    // Event name -> u16 code, keyed by the interned name
+    hashmap namedCodes;
+    // DinoArray every code's listeners live in. See EventCodeEntry
+    RegisteredEventPairing* listeners;
+    // Slots in `listeners` that no range uses anymore
+    u32 wastedListeners;
+    // EventSubscription -> EventSubscriptionRecord
+    slotmap subscriptions;
+    // DinoArray of codes with tombstones to compact at frame end
+    u16* dirtyCodes;
+    ActiveFire fires[EVENT_MAX_FIRE_DEPTH];
+    u32 fireDepth;
+    EventQueue queues[2];
+    // Queue `eventPost` appends to
+    u32 postQueue;
+    // Posted from other threads. Only the main thread pops. Its memory is
+    // right after this struct
+    mpmcQueue inbox;
+    PF_EventWorkerDispatch workerDispatch;
+    void* workerDispatchUser;
+#ifdef GE_EVENT_INSTRUMENTATION
+    // Ring of the last EVENT_TRACE_CAPACITY records. Its memory is after the
+    // inbox's
+    EventTraceRecord* trace;
+    // Records ever written. The next one goes at traceWritten % capacity
+    u64 traceWritten;
+    u32 frame;
+#endif
 } EventSystemState;
 
 static EventSystemState* systemPtr;
 
 b8 eventInit(u64* memoryRequirement, void* state) {
-    *memoryRequirement = sizeof(EventSystemState);
+    u64 inboxMemReq = 0;
+    mpmcQueueCreate(sizeof(InboxEvent), EVENT_INBOX_CAPACITY, &inboxMemReq, 0,
+                    0);
+    *memoryRequirement = sizeof(EventSystemState) + inboxMemReq;
+#ifdef GE_EVENT_INSTRUMENTATION
+    *memoryRequirement += sizeof(EventTraceRecord) * EVENT_TRACE_CAPACITY;
+#endif
     if (state == 0) {
         return true;
     }
     systemPtr = state;
+    mpmcQueueCreate(sizeof(InboxEvent), EVENT_INBOX_CAPACITY, &inboxMemReq,
+                    (u8*)state + sizeof(EventSystemState), &systemPtr->inbox);
+    systemPtr->workerDispatch = 0;
+    systemPtr->workerDispatchUser = 0;
+#ifdef GE_EVENT_INSTRUMENTATION
+    systemPtr->trace = (EventTraceRecord*)((u8*)state + sizeof(EventSystemState) +
+                                           inboxMemReq);
+    systemPtr->traceWritten = 0;
+    systemPtr->frame = 0;
+#endif
+
+    fzeroMemory(systemPtr->systemCodes, sizeof(systemPtr->systemCodes));
+    for (u32 i = 0; i < EVENT_CODE_MAX_TAGS; ++i) {
+        systemPtr->systemCodes[i].queuedCode = INVALID_ID;
+#ifdef GE_EVENT_INSTRUMENTATION
+        systemPtr->systemCodes[i].name = STRING_ID_INVALID;
+#endif
+    }
+    systemPtr->userCodes = dinoCreate(EventCodeEntry);
+    if (!hashmapCreate(sizeof(u16), 0, true, &systemPtr->namedCodes)) {
+        FERROR("Failed to create the event name map.");
+        return false;
+    }
+    systemPtr->listeners = dinoCreate(RegisteredEventPairing);
+    systemPtr->wastedListeners = 0;
+    if (!slotmapCreate(sizeof(EventSubscriptionRecord), 0,
+                       &systemPtr->subscriptions)) {
+        FERROR("Failed to create the event subscription map.");
+        return false;
+    }
+    systemPtr->dirtyCodes = dinoCreate(u16);
+    systemPtr->fireDepth = 0;
+    for (u32 i = 0; i < 2; ++i) {
+        systemPtr->queues[i].events = dinoCreate(QueuedEvent);
+        systemPtr->queues[i].codes = dinoCreate(QueuedCode);
+    }
+    systemPtr->postQueue = 0;
+
+    // Only the latest position/size matters to listeners
+    systemPtr->systemCodes[EVENT_CODE_MOUSE_MOVED].coalesce = true;
+    systemPtr->systemCodes[EVENT_CODE_RESIZED].coalesce = true;
     return true;
 }
 
 void eventShutdown() {
     if (!systemPtr) {
         FERROR("Event system was called before it was inited.")
+        return;
     }
-    // Free ALL THE DINOS.
-    for (u16 i = 0; i < MAX_MESSAGE_CODES; ++i) {
-        if (systemPtr->registered[i].events != 0) {
-            dinoDestroy(systemPtr->registered[i].events);
-            systemPtr->registered[i].events = 0;
-        }
+    dinoDestroy(systemPtr->listeners);
+    dinoDestroy(systemPtr->userCodes);
+    dinoDestroy(systemPtr->dirtyCodes);
+    slotmapDestroy(&systemPtr->subscriptions);
+    hashmapDestroy(&systemPtr->namedCodes);
+    for (u32 i = 0; i < 2; ++i) {
+        dinoDestroy(systemPtr->queues[i].events);
+        dinoDestroy(systemPtr->queues[i].codes);
     }
     systemPtr = 0;
 }
 
+// Entry for `code`, 0 if the code doesn't exist
+static EventCodeEntry* getEntry(u16 code) {
+    if (code < EVENT_CODE_MAX_TAGS) {
+        return &systemPtr->systemCodes[code];
+    }
+    u32 index = code - EVENT_CODE_MAX_TAGS;
+    if (index < dinoLength(systemPtr->userCodes)) {
+        return &systemPtr->userCodes[index];
+    }
+    return 0;
+}
+
+// Rebuilds the pool with every range packed back to back
+static void compactListeners() {
+    RegisteredEventPairing* old = systemPtr->listeners;
+    u64 used = dinoLength(old) - systemPtr->wastedListeners;
+    RegisteredEventPairing* packed =
+        dinoCreateReserve(used, RegisteredEventPairing);
+
+    u64 codeCount = EVENT_CODE_MAX_TAGS + dinoLength(systemPtr->userCodes);
+    for (u64 code = 0; code < codeCount; ++code) {
+        EventCodeEntry* entry = getEntry((u16)code);
+        if (entry->capacity == 0) {
+            continue;
+        }
+        u32 first = (u32)dinoLength(packed);
+        dinoPushN(packed, &old[entry->first], entry->capacity);
+        entry->first = first;
+    }
+
+    dinoDestroy(old);
+    systemPtr->listeners = packed;
+    systemPtr->wastedListeners = 0;
+}
+
+// Makes room for one more listener in `entry`'s range. A full range is moved
+// to the end of the pool with twice the room
+static void growRange(EventCodeEntry* entry) {
+    if (entry->count < entry->capacity) {
+        return;
+    }
+    u32 capacity =
+        entry->capacity ? entry->capacity * 2 : EVENT_LISTENER_RANGE_MIN;
+    u64 first = dinoLength(systemPtr->listeners);
+    dinoReserve(systemPtr->listeners, first + capacity);
+    dinoLengthSet(systemPtr->listeners, first + capacity);
+    fcpyMem(&systemPtr->listeners[first], &systemPtr->listeners[entry->first],
+            sizeof(RegisteredEventPairing) * entry->count);
+
+    systemPtr->wastedListeners += entry->capacity;
+    entry->first = (u32)first;
+    entry->capacity = capacity;
+
+    if (systemPtr->wastedListeners >= EVENT_LISTENER_COMPACT_MIN &&
+        systemPtr->wastedListeners * 2 > dinoLength(systemPtr->listeners)) {
+        compactListeners();
+    }
+}
+
+u16 eventGetCode(const char* name) {
+    if (!systemPtr) {
+        FERROR("Event system was called before it was inited.")
+        return INVALID_ID_U16;
+    }
+
+    u16* found = hashmapGetStr(&systemPtr->namedCodes, name);
+    if (found) {
+        return *found;
+    }
+
+    u64 code = EVENT_CODE_MAX_TAGS + dinoLength(systemPtr->userCodes);
+    if (code >= INVALID_ID_U16) {
+        FERROR("Out of event codes, can't add '%s'.", name);
+        return INVALID_ID_U16;
+    }
+    // The map only keeps the key pointer, the interned copy lives long enough
+    stringId nameId = stringIntern(name);
+    const char* interned = stringGet(nameId);
+    if (!interned) {
+        return INVALID_ID_U16;
+    }
+
+    EventCodeEntry entry = {0};
+    entry.queuedCode = INVALID_ID;
+#ifdef GE_EVENT_INSTRUMENTATION
+    entry.name = nameId;
+#endif
+    systemPtr->userCodes = dinoPush_EventCodeEntry(systemPtr->userCodes, entry);
+    u16 newCode = (u16)code;
+    hashmapInsertStr(&systemPtr->namedCodes, interned, &newCode);
+    return newCode;
+}
+
+#ifdef GE_EVENT_INSTRUMENTATION
+static void addStats(EventStats* stats, f64 duration, b8 handled) {
+    stats->calls++;
+    stats->handled += handled;
+    stats->totalTime += duration;
+    if (duration > stats->maxTime) {
+        stats->maxTime = duration;
+    }
+}
+
+static void traceRecord(u8 kind, u16 code, f64 start, f64 duration,
+                        b8 handled, PF_OnEvent callback, void* listener) {
+    EventTraceRecord* record =
+        &systemPtr->trace[systemPtr->traceWritten++ % EVENT_TRACE_CAPACITY];
+    record->start = start;
+    record->duration = duration;
+    record->callback = (u64)callback;
+    record->listener = (u64)listener;
+    record->frame = systemPtr->frame;
+    record->code = code;
+    record->kind = kind;
+    record->handled = handled;
+}
+
+// `index` is the listener's place in the range after its callback returned
+static void recordListenerCall(u16 code, u32 index, RegisteredEventPairing* e,
+                               f64 start, b8 handled) {
+    f64 duration = platformGetAbsoluteTime() - start;
+    EventCodeEntry* entry = getEntry(code);
+    addStats(&systemPtr->listeners[entry->first + index].stats, duration,
+             handled);
+    traceRecord(EVENT_TRACE_CALL, code, start, duration, handled,
+                e->functionCallback, e->listener);
+}
+#endif
+
+// Entry's listeners with the subscription offsets moved from `from` to `to`
+static void moveListeners(EventCodeEntry* entry, u32 to, u32 from, u32 count) {
+    RegisteredEventPairing* events = &systemPtr->listeners[entry->first];
+    memmove(&events[to], &events[from], sizeof(RegisteredEventPairing) * count);
+    for (u32 i = to; i < to + count; ++i) {
+        EventSubscriptionRecord* record =
+            slotmapGet(&systemPtr->subscriptions, events[i].subscription);
+        if (record) {
+            record->offset = i;
+        }
+    }
+}
+
+EventSubscription eventSubscribe(u16 code, void* listener,
+                                 PF_OnEvent onEvent, i32 priority, u32 flags) {
+    if (!systemPtr) {
+        FERROR("Event system was called before it was inited.")
+        return EVENT_SUBSCRIPTION_INVALID;
+    }
+    if (!onEvent) {
+        FERROR("eventSubscribe called without a callback.");
+        return EVENT_SUBSCRIPTION_INVALID;
+    }
+
+    EventCodeEntry* entry = getEntry(code);
+    if (!entry) {
+        FERROR("eventSubscribe called with an unknown event code (%u).", code);
+        return EVENT_SUBSCRIPTION_INVALID;
+    }
+
+    EventSubscriptionRecord* record;
+    EventSubscription subscription =
+        slotmapInsert(&systemPtr->subscriptions, 0, (void**)&record);
+    if (subscription == SLOT_HANDLE_INVALID) {
+        return EVENT_SUBSCRIPTION_INVALID;
+    }
+
+    growRange(entry);
+
+    // Higher priorities first, after everything with the same priority so
+    // ties keep subscribe order
+    RegisteredEventPairing* events = &systemPtr->listeners[entry->first];
+    u32 index = entry->count;
+    while (index > 0 && events[index - 1].priority < priority) {
+        index--;
+    }
+    moveListeners(entry, index + 1, index, entry->count - index);
+    entry->count++;
+
+    // A fire of this code past `index` would see its current listener again
+    for (u32 i = 0; i < systemPtr->fireDepth; ++i) {
+        ActiveFire* fire = &systemPtr->fires[i];
+        if (fire->code == code && fire->index >= index) {
+            fire->index++;
+        }
+    }
+
+    RegisteredEventPairing* event = &events[index];
+    event->listener = listener;
+    event->functionCallback = onEvent;
+    event->flags = flags;
+    event->priority = priority;
+    event->subscription = subscription;
+#ifdef GE_EVENT_INSTRUMENTATION
+    fzeroMemory(&event->stats, sizeof(event->stats));
+#endif
+
+    record->code = code;
+    record->offset = index;
+    return subscription;
+}
+
+// Tombstones the listener at `offset`. The slot is reclaimed at frame end
+static void removeListener(u16 code, EventCodeEntry* entry, u32 offset) {
+    RegisteredEventPairing* event =
+        &systemPtr->listeners[entry->first + offset];
+    slotmapRemove(&systemPtr->subscriptions, event->subscription);
+    event->functionCallback = 0;
+    event->subscription = EVENT_SUBSCRIPTION_INVALID;
+    if (entry->tombstones++ == 0) {
+        dinoPush(systemPtr->dirtyCodes, code);
+    }
+}
+
+b8 eventUnsubscribe(EventSubscription subscription) {
+    if (!systemPtr) {
+        FERROR("Event system was called before it was inited.")
+        return false;
+    }
+
+    EventSubscriptionRecord* record =
+        slotmapGet(&systemPtr->subscriptions, subscription);
+    if (!record) {
+        FWARN("eventUnsubscribe called with a stale subscription.");
+        return false;
+    }
+    EventSubscriptionRecord found = *record;
+    removeListener(found.code, getEntry(found.code), found.offset);
+    return true;
+}
+
+void eventFrameEnd() {
+    if (!systemPtr) {
+        FERROR("Event system was called before it was inited.")
+        return;
+    }
+
+    // Squeeze the tombstones out of every range that has some
+    u64 dirtyCount = dinoLength(systemPtr->dirtyCodes);
+    for (u64 i = 0; i < dirtyCount; ++i) {
+        EventCodeEntry* entry = getEntry(systemPtr->dirtyCodes[i]);
+        RegisteredEventPairing* events = &systemPtr->listeners[entry->first];
+        u32 live = 0;
+        for (u32 read = 0; read < entry->count; ++read) {
+            if (!events[read].functionCallback) {
+                continue;
+            }
+            if (read != live) {
+                moveListeners(entry, live, read, 1);
+            }
+            live++;
+        }
+        entry->count = live;
+        entry->tombstones = 0;
+    }
+    dinoClear(systemPtr->dirtyCodes);
+
+#ifdef GE_EVENT_INSTRUMENTATION
+    // Marks where the frame ended in the trace
+    traceRecord(EVENT_TRACE_FRAME, 0, platformGetAbsoluteTime(), 0, false, 0,
+                0);
+    systemPtr->frame++;
+#endif
+}
+
 b8 eventRegister(u16 code, void* listener, PF_OnEvent onEvent) {
+    return eventRegisterEx(code, listener, onEvent, EVENT_LISTENER_FLAG_NONE);
+}
+
+b8 eventRegisterEx(u16 code, void* listener, PF_OnEvent onEvent, u32 flags) {
     if (!systemPtr) {
         FERROR("Event system was called before it was inited.")
         return false;
     }
 
-    // Each event code has it's own dinoArray of listeners.
-    // If it has zero listeners then create it
-    if (systemPtr->registered[code].events == 0) {
-        systemPtr->registered[code].events = dinoCreate(RegisteredEventPairing);
+    EventCodeEntry* entry = getEntry(code);
+    if (!entry) {
+        FERROR("eventRegister called with an unknown event code (%u).", code);
+        return false;
     }
 
-    u64 registeredPairings = dinoLength(systemPtr->registered[code].events);
-    for (u64 i = 0; i < registeredPairings; i++) {
+    RegisteredEventPairing* events = &systemPtr->listeners[entry->first];
+    for (u32 i = 0; i < entry->count; i++) {
         // If the pairing already exists don't add another. or the onEventFN
         // while get called twice confusing the user
-        RegisteredEventPairing e = systemPtr->registered[code].events[i];
-        if (e.listener == listener && e.functionCallback == onEvent) {
+        if (events[i].listener == listener &&
+            events[i].functionCallback == onEvent) {
             FWARN("Event listener/onEvent pairing already added.");
             return false;
         }
     }
 
-    RegisteredEventPairing event;
-    event.listener = listener;
-    event.functionCallback = onEvent;
-    dinoPush(systemPtr->registered[code].events, event);
-
-    return true;
+    return eventSubscribe(code, listener, onEvent, EVENT_PRIORITY_DEFAULT,
+                          flags) != EVENT_SUBSCRIPTION_INVALID;
 }
 
 b8 eventUnregister(u16 code, void* listener, PF_OnEvent onEvent) {
@@ -81,18 +529,17 @@ b8 eventUnregister(u16 code, void* listener, PF_OnEvent onEvent) {
         return false;
     }
 
-    if (systemPtr->registered[code].events == 0) {
+    EventCodeEntry* entry = getEntry(code);
+    if (!entry || entry->count == entry->tombstones) {
         FWARN("Event code has no listeners registered.");
         return false;
     }
 
-    u64 registeredPairings = dinoLength(systemPtr->registered[code].events);
-    for (u64 i = 0; i < registeredPairings; ++i) {
-        RegisteredEventPairing e = systemPtr->registered[code].events[i];
-        if (e.listener == listener && e.functionCallback == onEvent) {
-            RegisteredEventPairing pairingToDel;
-            dinoPopAt(systemPtr->registered[code].events, i, &pairingToDel);
-
+    RegisteredEventPairing* events = &systemPtr->listeners[entry->first];
+    for (u32 i = 0; i < entry->count; ++i) {
+        if (events[i].listener == listener &&
+            events[i].functionCallback == onEvent) {
+            removeListener(code, entry, i);
             return true;
         }
     }
@@ -100,6 +547,61 @@ b8 eventUnregister(u16 code, void* listener, PF_OnEvent onEvent) {
     return false;
 }
 
+// Sends the event to `code`'s listeners in order until one handles it. Worker
+// listeners are handed to the dispatcher and can't handle it. The entry is
+// looked up every time since a listener can subscribe and move the pool
+static b8 fireToListeners(u16 code, void* sender, EventContext context) {
+    if (systemPtr->fireDepth >= EVENT_MAX_FIRE_DEPTH) {
+        FERROR("Events fired more than %u deep, dropping event %u.",
+               EVENT_MAX_FIRE_DEPTH, code);
+        return false;
+    }
+    ActiveFire* fire = &systemPtr->fires[systemPtr->fireDepth++];
+    fire->code = code;
+    b8 handled = false;
+#ifdef GE_EVENT_INSTRUMENTATION
+    f64 fireStart = platformGetAbsoluteTime();
+#endif
+    for (fire->index = 0;; ++fire->index) {
+        EventCodeEntry* entry = getEntry(code);
+        if (fire->index >= entry->count) {
+            break;
+        }
+        RegisteredEventPairing e =
+            systemPtr->listeners[entry->first + fire->index];
+        if (!e.functionCallback) {
+            continue;
+        }
+#ifdef GE_EVENT_INSTRUMENTATION
+        f64 start = platformGetAbsoluteTime();
+#endif
+        b8 result = false;
+        if ((e.flags & EVENT_LISTENER_FLAG_WORKER) &&
+            systemPtr->workerDispatch) {
+            systemPtr->workerDispatch(e.functionCallback, code, sender,
+                                      e.listener, context,
+                                      systemPtr->workerDispatchUser);
+        } else {
+            result = e.functionCallback(code, sender, e.listener, context);
+        }
+#ifdef GE_EVENT_INSTRUMENTATION
+        recordListenerCall(code, fire->index, &e, start, result);
+#endif
+        if (result) {
+            // Event has been handled, do not send to other listeners.
+            handled = true;
+            break;
+        }
+    }
+    systemPtr->fireDepth--;
+#ifdef GE_EVENT_INSTRUMENTATION
+    f64 fireTime = platformGetAbsoluteTime() - fireStart;
+    addStats(&getEntry(code)->stats, fireTime, handled);
+    traceRecord(EVENT_TRACE_FIRE, code, fireStart, fireTime, handled, 0, 0);
+#endif
+    return handled;
+}
+
 b8 eventFire(u16 code, void* sender, EventContext context) {
     if (!systemPtr) {
         FERROR("Event system was called before it was inited.")
@@ -107,18 +609,247 @@ b8 eventFire(u16 code, void* sender, EventContext context) {
     }
 
     // If their are no listeners. Return false so the gamedev can know
-    if (systemPtr->registered[code].events == 0) {
+    EventCodeEntry* entry = getEntry(code);
+    if (!entry || entry->count == entry->tombstones) {
         return false;
     }
 
-    u64 registeredPairings = dinoLength(systemPtr->registered[code].events);
-    for (u64 i = 0; i < registeredPairings; ++i) {
-        RegisteredEventPairing e = systemPtr->registered[code].events[i];
-        if (e.functionCallback(code, sender, e.listener, context)) {
-            // Event has been handled, do not send to other listeners.
+    return fireToListeners(code, sender, context);
+}
+
+b8 eventPost(u16 code, void* sender, EventContext context) {
+    if (!systemPtr) {
+        FERROR("Event system was called before it was inited.")
+        return false;
+    }
+    EventCodeEntry* entry = getEntry(code);
+    if (!entry) {
+        FERROR("eventPost called with an unknown event code (%u).", code);
+        return false;
+    }
+
+    EventQueue* queue = &systemPtr->queues[systemPtr->postQueue];
+
+    QueuedEvent event;
+    event.sender = sender;
+    event.context = context;
+    event.next = INVALID_ID;
+
+    if (entry->queuedCode != INVALID_ID) {
+        QueuedCode* queued = &queue->codes[entry->queuedCode];
+        if (entry->coalesce) {
+            // Replace the one already queued
+            queue->events[queued->first] = event;
             return true;
         }
+        u32 index = (u32)dinoLength(queue->events);
+        queue->events = dinoPush_QueuedEvent(queue->events, event);
+        queue->events[queued->last].next = index;
+        queued->last = index;
+        return true;
     }
 
+    u32 index = (u32)dinoLength(queue->events);
+    queue->events = dinoPush_QueuedEvent(queue->events, event);
+    QueuedCode queued = {code, index, index};
+    entry->queuedCode = (u32)dinoLength(queue->codes);
+    queue->codes = dinoPush_QueuedCode(queue->codes, queued);
+    return true;
+}
+
+b8 eventPostFromThread(u16 code, void* sender, EventContext context) {
+    if (!systemPtr) {
+        return false;
+    }
+    InboxEvent event;
+    event.code = code;
+    event.sender = sender;
+    event.context = context;
+    return mpmcQueuePush(&systemPtr->inbox, &event);
+}
+
+void eventDispatchQueued() {
+    if (!systemPtr) {
+        FERROR("Event system was called before it was inited.")
+        return;
+    }
+
+    // Move what other threads posted into the frame's queue so it's grouped
+    // and coalesced like everything else
+    InboxEvent inboxEvent;
+    while (mpmcQueuePop(&systemPtr->inbox, &inboxEvent)) {
+        eventPost(inboxEvent.code, inboxEvent.sender, inboxEvent.context);
+    }
+
+    // Swap queues first so events posted by listeners go out next frame
+    EventQueue* queue = &systemPtr->queues[systemPtr->postQueue];
+    systemPtr->postQueue ^= 1;
+    u64 codeCount = dinoLength(queue->codes);
+    for (u64 i = 0; i < codeCount; ++i) {
+        getEntry(queue->codes[i].code)->queuedCode = INVALID_ID;
+    }
+
+    // One code at a time so its listener range stays in cache for the whole
+    // batch
+    for (u64 i = 0; i < codeCount; ++i) {
+        QueuedCode queued = queue->codes[i];
+        EventCodeEntry* entry = getEntry(queued.code);
+        if (entry->count == entry->tombstones) {
+            continue;
+        }
+        for (u32 e = queued.first; e != INVALID_ID;
+             e = queue->events[e].next) {
+            fireToListeners(queued.code, queue->events[e].sender,
+                            queue->events[e].context);
+        }
+    }
+
+    dinoClear(queue->events);
+    dinoClear(queue->codes);
+}
+
+void eventSetWorkerDispatcher(PF_EventWorkerDispatch dispatch, void* user) {
+    if (!systemPtr) {
+        FERROR("Event system was called before it was inited.")
+        return;
+    }
+    systemPtr->workerDispatch = dispatch;
+    systemPtr->workerDispatchUser = user;
+}
+
+void eventSetCoalescing(u16 code, b8 coalesce) {
+    if (!systemPtr) {
+        FERROR("Event system was called before it was inited.")
+        return;
+    }
+    EventCodeEntry* entry = getEntry(code);
+    if (!entry) {
+        FERROR("eventSetCoalescing called with an unknown event code (%u).",
+               code);
+        return;
+    }
+    entry->coalesce = coalesce;
+}
+
+b8 eventGetCodeStats(u16 code, EventStats* outStats) {
+#ifdef GE_EVENT_INSTRUMENTATION
+    EventCodeEntry* entry = systemPtr ? getEntry(code) : 0;
+    if (!entry) {
+        return false;
+    }
+    *outStats = entry->stats;
+    return true;
+#else
+    return false;
+#endif
+}
+
+b8 eventGetSubscriptionStats(EventSubscription subscription,
+                             EventStats* outStats) {
+#ifdef GE_EVENT_INSTRUMENTATION
+    EventSubscriptionRecord* record =
+        systemPtr ? slotmapGet(&systemPtr->subscriptions, subscription) : 0;
+    if (!record) {
+        return false;
+    }
+    EventCodeEntry* entry = getEntry(record->code);
+    *outStats = systemPtr->listeners[entry->first + record->offset].stats;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void eventReport() {
+#ifdef GE_EVENT_INSTRUMENTATION
+    if (!systemPtr) {
+        FERROR("Event system was called before it was inited.")
+        return;
+    }
+
+    printf("Event report (%u frames)\n", systemPtr->frame);
+    printf("  %-24s  %10s  %8s  %12s  %12s\n", "Code/Listener", "Calls",
+           "Handled", "Avg (us)", "Max (us)");
+    u64 codeCount = EVENT_CODE_MAX_TAGS + dinoLength(systemPtr->userCodes);
+    for (u64 code = 0; code < codeCount; ++code) {
+        EventCodeEntry* entry = getEntry((u16)code);
+        if (entry->stats.calls == 0) {
+            continue;
+        }
+        EventStats* stats = &entry->stats;
+        const char* name = stringGet(entry->name);
+        char label[32];
+        if (name) {
+            snprintf(label, sizeof(label), "%s", name);
+        } else {
+            snprintf(label, sizeof(label), "code %llu", code);
+        }
+        printf("  %-24s  %10llu  %7.1f%%  %12.3f  %12.3f\n", label,
+               stats->calls, 100.0 * stats->handled / stats->calls,
+               stats->totalTime * 1000000.0 / stats->calls,
+               stats->maxTime * 1000000.0);
+
+        RegisteredEventPairing* events = &systemPtr->listeners[entry->first];
+        for (u32 i = 0; i < entry->count; ++i) {
+            stats = &events[i].stats;
+            if (!events[i].functionCallback || stats->calls == 0) {
+                continue;
+            }
+            printf("    %-22p  %10llu  %7.1f%%  %12.3f  %12.3f\n",
+                   (void*)events[i].functionCallback, stats->calls,
+                   100.0 * stats->handled / stats->calls,
+                   stats->totalTime * 1000000.0 / stats->calls,
+                   stats->maxTime * 1000000.0);
+        }
+    }
+#else
+    FWARN("eventReport needs a build with -DGE_EVENT_INSTRUMENTATION.");
+#endif
+}
+
+b8 eventTraceDump(const char* path) {
+#ifdef GE_EVENT_INSTRUMENTATION
+    if (!systemPtr) {
+        FERROR("Event system was called before it was inited.")
+        return false;
+    }
+
+    FileHandle file;
+    if (!fsOpen(path, FILE_MODE_WRITE, true, &file)) {
+        FERROR("eventTraceDump couldn't open '%s'.", path);
+        return false;
+    }
+
+    u64 count = systemPtr->traceWritten < EVENT_TRACE_CAPACITY
+                    ? systemPtr->traceWritten
+                    : EVENT_TRACE_CAPACITY;
+    EventTraceFileHeader header;
+    fcpyMem(header.magic, EVENT_TRACE_MAGIC, sizeof(header.magic));
+    header.version = EVENT_TRACE_VERSION;
+    header.recordSize = sizeof(EventTraceRecord);
+    header.recordCount = (u32)count;
+
+    // Oldest record first. Once the ring has wrapped that's the one the next
+    // write would overwrite
+    u64 oldest = (systemPtr->traceWritten - count) % EVENT_TRACE_CAPACITY;
+    u64 firstPart = count < EVENT_TRACE_CAPACITY - oldest
+                        ? count
+                        : EVENT_TRACE_CAPACITY - oldest;
+    u64 written = 0;
+    b8 result =
+        fsWrite(&file, sizeof(header), &header, &written) &&
+        fsWrite(&file, sizeof(EventTraceRecord) * firstPart,
+                &systemPtr->trace[oldest], &written) &&
+        (count == firstPart ||
+         fsWrite(&file, sizeof(EventTraceRecord) * (count - firstPart),
+                 systemPtr->trace, &written));
+    fsClose(&file);
+    if (!result) {
+        FERROR("eventTraceDump failed to write '%s'.", path);
+    }
+    return result;
+#else
+    FWARN("eventTraceDump needs a build with -DGE_EVENT_INSTRUMENTATION.");
     return false;
+#endif
 }
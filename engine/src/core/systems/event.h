@@ -40,6 +40,84 @@ typedef struct EventContext {
 typedef b8 (*PF_OnEvent)(u16 eventCode, void* sender, void* listenerInstance,
                          EventContext data);
 
+/**
+ * @brief A Pointer Function (PF) that runs a worker listener's callback on
+ * another thread, e.g. by queueing a job. Whatever it calls must be safe to run
+ * off the main thread.
+ * @param onEvent The listener's callback to call with the rest of the params.
+ * @param user The pointer given to `eventSetWorkerDispatcher`.
+ */
+typedef void (*PF_EventWorkerDispatch)(PF_OnEvent onEvent, u16 eventCode,
+                                       void* sender, void* listenerInstance,
+                                       EventContext data, void* user);
+
+/**
+ * @brief Handle to one listener from `eventSubscribe`. Goes stale once the
+ * listener is unsubscribed.
+ */
+typedef u64 EventSubscription;
+
+#define EVENT_SUBSCRIPTION_INVALID 0
+
+// Priority `eventRegister` listeners get. Higher priorities are called first
+#define EVENT_PRIORITY_DEFAULT 0
+
+/**
+ * @brief Counts and timings gathered with -DGE_EVENT_INSTRUMENTATION. For a
+ * code `calls` is the number of fires and the time is the whole fire, for a
+ * listener it's its own callback. Times are in seconds.
+ */
+typedef struct EventStats {
+    u64 calls;
+    // Calls that returned true. Worker listeners never count as handled
+    u64 handled;
+    f64 totalTime;
+    f64 maxTime;
+} EventStats;
+
+typedef enum EventTraceKind {
+    // One listener's callback
+    EVENT_TRACE_CALL,
+    // A whole fire, written after the calls it made
+    EVENT_TRACE_FIRE,
+    // `eventFrameEnd`. `frame` is the frame that just ended
+    EVENT_TRACE_FRAME
+} EventTraceKind;
+
+/**
+ * @brief One record of the file written by `eventTraceDump`. The file is an
+ * EventTraceFileHeader then `recordCount` of these, oldest first.
+ */
+typedef struct EventTraceRecord {
+    // platformGetAbsoluteTime at the start, in seconds
+    f64 start;
+    f64 duration;
+    // PF_OnEvent address and listener instance, 0 if not an EVENT_TRACE_CALL
+    u64 callback;
+    u64 listener;
+    u32 frame;
+    u16 code;
+    u8 kind;
+    u8 handled;
+} EventTraceRecord;
+
+typedef struct EventTraceFileHeader {
+    // "GEET"
+    char magic[4];
+    u32 version;
+    // sizeof(EventTraceRecord) so readers can check the layout
+    u32 recordSize;
+    u32 recordCount;
+} EventTraceFileHeader;
+
+typedef enum EventListenerFlags {
+    EVENT_LISTENER_FLAG_NONE = 0,
+    /** @brief Called through the worker dispatcher instead of on the thread
+     * that fires the event. Its return value is never seen, so it can't mark
+     * an event as handled. Called inline if no dispatcher is set. */
+    EVENT_LISTENER_FLAG_WORKER = 0x1
+} EventListenerFlags;
+
 /**
  * @brief Init the event system. Must be called twice once with no state (state
  * = 0) to get the memoryRequirement. Another after the state has been assigned
@@ -56,10 +134,50 @@ b8 eventInit(u64* memoryRequirement, void* state);
  */
 void eventShutdown();
 
+/**
+ * Gets the code for a user-defined event, adding it the first time the name is
+ * seen. The same name always gives the same code. Codes are only valid with
+ * the event FNs, other codes than these and systemEventCode are rejected.
+ * Needs the string table to be inited.
+ * @param name The event's name.
+ * @returns the code, INVALID_ID_U16 if failed
+ */
+CT_API u16 eventGetCode(const char* name);
+
+/**
+ * Subscribe to events with the provided code. Listeners are called from the
+ * highest priority to the lowest, same priorities in subscribe order. Unlike
+ * `eventRegister` the same listener/onEvent pairing can be added more than
+ * once, each gets its own subscription.
+ * @param code The event code to listen for.
+ * @param listener A pointer to a listener instance. Can be 0/NULL.
+ * @param onEvent The callback function pointer to be invoked when the event
+ * code is fired.
+ * @param priority Where the listener goes in the call order.
+ * @param flags EventListenerFlags.
+ * @returns the subscription, EVENT_SUBSCRIPTION_INVALID if failed
+ */
+CT_API EventSubscription eventSubscribe(u16 code, void* listener,
+                                        PF_OnEvent onEvent, i32 priority,
+                                        u32 flags);
+
+/**
+ * Stops the subscription's listener from being called. O(1), the slot it used
+ * is reclaimed by `eventFrameEnd`.
+ * @returns false if the subscription was already stale
+ */
+CT_API b8 eventUnsubscribe(EventSubscription subscription);
+
+/**
+ * Compacts the listener lists that had listeners removed this frame. Called
+ * once a frame by the engine, never while an event is firing.
+ */
+void eventFrameEnd();
+
 /**
  * Register to listen for when events are sent with the provided code. Events
  * with duplicate `listener` & `onEvent` pairings will not be registered
- * and this FN will return false.
+ * and this FN will return false. Registered with EVENT_PRIORITY_DEFAULT.
  * @param code The event code to listen for.
  * @param listener A pointer to a listener instance. Can be 0/NULL.
  * @param onEvent The callback function pointer to be invoked when the event
@@ -68,6 +186,12 @@ void eventShutdown();
  */
 CT_API b8 eventRegister(u16 code, void* listener, PF_OnEvent onEvent);
 
+/**
+ * Same as `eventRegister` with EventListenerFlags.
+ */
+CT_API b8 eventRegisterEx(u16 code, void* listener, PF_OnEvent onEvent,
+                          u32 flags);
+
 /**
  * Unregister from listening for when events are sent with the provided code. If
  * no `listener` & `onEvent` pairing is found, this FN returns false.
@@ -91,9 +215,52 @@ CT_API b8 eventUnregister(u16 code, void* listener, PF_OnEvent onEvent);
  */
 CT_API b8 eventFire(u16 code, void* sender, EventContext context);
 
-// TODO: Make the event system take strings instead of enums. So users can make
-// custom user-defined events. Will need to use a hashmap tho. For these codes
-// use that preprocessor trick to make an enum & string array at the same time.
+/**
+ * Queues an event to be fired by `eventDispatchQueued` at the start of the
+ * next frame instead of right away. Use it for events that can come in bursts
+ * (mouse motion, resizes) so listeners aren't called in the middle of the
+ * platform's message pump.
+ * @param code The event code to post.
+ * @param sender A pointer to the sender. Can be 0/NULL.
+ * @param data The event data.
+ * @returns true if the event was queued
+ */
+CT_API b8 eventPost(u16 code, void* sender, EventContext context);
+
+/**
+ * Fires every posted event. Events are grouped by code, in the order each code
+ * was first posted, and keep their posting order within a code. Each one is
+ * sent to listeners like `eventFire`. Events posted while dispatching are
+ * delivered on the next call. Called once a frame by the engine.
+ */
+void eventDispatchQueued();
+
+/**
+ * Same as `eventPost` but safe to call from any thread. The event goes into a
+ * lock-free inbox that the main thread moves into the queue at the start of
+ * `eventDispatchQueued`. Listeners are still called on the main thread (or
+ * the worker dispatcher).
+ * @returns false if the inbox is full (4096 events per frame)
+ */
+CT_API b8 eventPostFromThread(u16 code, void* sender, EventContext context);
+
+/**
+ * Sets the function EVENT_LISTENER_FLAG_WORKER listeners are handed to. 0 to
+ * call them inline again.
+ * @param user Passed to every `dispatch` call. Can be 0/NULL.
+ */
+CT_API void eventSetWorkerDispatcher(PF_EventWorkerDispatch dispatch,
+                                     void* user);
+
+/**
+ * When on, posting `code` replaces the event already queued for it this frame
+ * so only the latest one is delivered. On by default for
+ * EVENT_CODE_MOUSE_MOVED and EVENT_CODE_RESIZED.
+ */
+CT_API void eventSetCoalescing(u16 code, b8 coalesce);
+
+// Codes the engine fires. User-defined events get codes after these from
+// `eventGetCode`.
 typedef enum systemEventCode {
     // ENGINE LEVEL EVENTS
 
@@ -162,3 +329,31 @@ typedef enum systemEventCode {
     /** Used as a hack to for-loop enums. Users shouldn't need this */
     EVENT_CODE_MAX_TAGS
 } systemEventCode;
+
+/**
+ * @brief Copies out the stats of every fire of `code`.
+ * @returns false if the code is unknown or the build isn't instrumented
+ */
+CT_API b8 eventGetCodeStats(u16 code, EventStats* outStats);
+
+/**
+ * @brief Copies out the stats of one listener.
+ * @returns false if the subscription is stale or the build isn't instrumented
+ */
+CT_API b8 eventGetSubscriptionStats(EventSubscription subscription,
+                                    EventStats* outStats);
+
+/**
+ * @brief Prints calls, handled % and avg/max time for every code that was
+ * fired and each of its listeners. `systemsShutdown` prints it in
+ * instrumented builds.
+ */
+CT_API void eventReport();
+
+/**
+ * @brief Writes the last frames' event trace to `path` in binary, see
+ * EventTraceRecord for the layout.
+ * @returns false if the file couldn't be written or the build isn't
+ * instrumented
+ */
+CT_API b8 eventTraceDump(const char* path);
@@ -1,49 +1,358 @@
+// Keeps the tracking macros from renaming the real functions below
+#define FMEMORY_IMPLEMENTATION
 #include "fmemory.h"
 
 #include "core/dynamicAllocator.h"
 #include "core/systems/logger.h"
 #include "platform/platform.h"
 
+#include <stdatomic.h>
 // TODO: Custom string lib
 #include <stdio.h>
 
 /*
- *  Currently using a dynamic allocator to allocate all memory at the start of
- * the program then it handles sectioning blocks and freeing them when needed.
+ *  Currently using a dynamic allocator to section one big block and free
+ * blocks when needed. The block sits at the start of a huge reserved address
+ * range, when it runs out the next part of the range is committed and the
+ * allocator grows into it. Blocks never move and anything inside the range
+ * belongs to us.
+ *
+ *  Each thread keeps a small magazine of blocks per size class. Allocs/frees
+ * that hit the magazine never touch the shared allocator. Only refills and
+ * returns take the lock, and they move half a magazine at a time.
+ *
+ *  Debug builds:
+ *  - GE_MEMORY_DEBUG poisons freed blocks and blocks handed out unzeroed, and
+ *    checks the freelist before every dynaAllocator operation.
+ *  - GE_MEMORY_GUARD_PAGES skips the pool. Every block gets its own mapping
+ *    with a PROT_NONE page right after it, so overflows fault on the spot and
+ *    freed blocks are unmapped. Slow and needs a mapping per block, meant for
+ *    stress tests.
  */
 
+// Blocks a thread can hold per size class. Half of it is moved on refill/return
+#define MEMORY_MAGAZINE_CAPACITY 32
+// The pool is committed/grown in steps of this. Multiple of the page size
+#define MEMORY_COMMIT_GRANULARITY KIBIBYTES(64)
+// Bytes freed blocks are filled with in GE_MEMORY_DEBUG builds
+#define MEMORY_POISON_FREED 0xDD
+// Bytes unzeroed blocks are filled with in GE_MEMORY_DEBUG builds
+#define MEMORY_POISON_UNINIT 0xCD
+// Starting slot count of the tracking table. Power of 2
+#define MEMORY_TRACKER_START_CAPACITY 4096
+
+typedef struct memoryMagazine {
+    u32 count;
+    void* blocks[MEMORY_MAGAZINE_CAPACITY];
+} memoryMagazine;
+
+typedef struct memoryThreadCache {
+    memoryMagazine magazines[DYNA_ALLOC_BIN_COUNT];
+} memoryThreadCache;
+
+// Stats are updated from any thread without a lock
 typedef struct memoryStats {
-    u64 totalMemAllocced;
-    u64 totalMemAllocsByTag[MEMORY_TAG_MAX_TAGS];
+    _Atomic u64 totalMemAllocced;
+    _Atomic u64 totalMemAllocsByTag[MEMORY_TAG_MAX_TAGS];
+    // Highest the totals above have ever been
+    _Atomic u64 peakMemAllocced;
+    _Atomic u64 peakMemAllocsByTag[MEMORY_TAG_MAX_TAGS];
+    _Atomic u64 allocCount;
+    _Atomic u64 freeCount;
+    _Atomic u64 allocCountByTag[MEMORY_TAG_MAX_TAGS];
+    _Atomic u64 freeCountByTag[MEMORY_TAG_MAX_TAGS];
+    // Every byte ever handed out. Only goes up, frames diff it
+    _Atomic u64 bytesAllocced;
 } memoryStats;
 
+// Per frame allocation rate. Only touched by the thread running the frames
+typedef struct memoryFrameStats {
+    // Counters when the last frame ended
+    u64 lastAllocCount;
+    u64 lastFreeCount;
+    u64 lastBytesAllocced;
+    // What the last frame did
+    u64 allocCount;
+    u64 freeCount;
+    u64 allocBytes;
+    u64 peakAllocCount;
+} memoryFrameStats;
+
+#ifdef GE_MEMORY_TRACKING
+// One live allocation. `block` is 0 for an empty slot
+typedef struct memoryTrackedBlock {
+    void* block;
+    const char* file;
+    u32 line;
+    f64 time;
+} memoryTrackedBlock;
+
+// Open addressing table keyed by the user's block. Lives in its own pages so
+// tracking never allocates through the system it's tracking.
+typedef struct memoryTracker {
+    memoryTrackedBlock* slots;
+    // Power of 2
+    u64 capacity;
+    u64 count;
+    PlatformMutex mutex;
+} memoryTracker;
+#endif
+
 typedef struct memorySystemState {
     // The stats for the memory. Used more for engine development. Might keep it
     // who knows
     memoryStats stats;
+    memoryFrameStats frameStats;
     // The settings for the memory system for more flexibity. (e.g. use
     // dynamicAllocator or not)
     MemorySystemSettings settings;
-    // The memory requirement needed for the dynamicAllocator to work. (e.g.
-    // Gamedev asked for 1Gib, so total memory needed could be 1.2Gib or
-    // something)
+    // The memory requirement for the dynamicAllocator's freelist. Changes
+    // every time the pool grows
     u64 allocatorMemReq;
-    // Block of memory the dynamicAllocator is allocated at
+    // Block of memory the dynamicAllocator's freelist is allocated at
     void* allocatorBlock;
+    // Start of the reserved range. The pool is the committed front of it
+    void* heapBlock;
+    // Size of the reserved range. Never changes after init
+    u64 reserveSize;
     // Ref to the dynamicAllocator
     dynaAllocator allocator;
+    // Guards `allocator`. Only taken when a thread cache misses
+    PlatformMutex allocatorMutex;
+#ifdef GE_MEMORY_TRACKING
+    memoryTracker tracker;
+#endif
 } memorySystemState;
 
+// Sits right in front of every block fmalloc hands out so ffree/frealloc
+// don't need the caller to remember anything
+typedef struct memoryHeader {
+    // Size the caller asked for
+    u64 size;
+    // Bytes from the start of the underlying block to the user's block
+    u32 padding;
+    u16 tag;
+    u16 flags;
+} memoryHeader;
+
+// Block has its own mapping with a guard page (GE_MEMORY_GUARD_PAGES)
+#define MEMORY_HEADER_FLAG_GUARDED 0x1
+
+STATIC_ASSERT(sizeof(memoryHeader) == FMEMORY_ALIGNMENT,
+              "memoryHeader has to keep blocks aligned.");
+
 static memorySystemState* systemPtr;
+static GE_THREAD_LOCAL memoryThreadCache threadCache;
+
+static memoryHeader* getHeader(void* block) {
+    return (memoryHeader*)block - 1;
+}
+
+// Fills `block` with `value` in GE_MEMORY_DEBUG builds so reads of dead or
+// uninitialized memory stand out
+static void poisonBlock(void* block, u64 size, u8 value) {
+#ifdef GE_MEMORY_DEBUG
+    platformSetMemory(block, value, size);
+#endif
+}
+
+// Alignment a block was allocated with, or one at least as strict
+static u64 getAlignment(memoryHeader* header, void* block) {
+    if (header->flags & MEMORY_HEADER_FLAG_GUARDED) {
+        // Padding is whatever pushed the block against the guard page. The
+        // lowest set bit of the address is as aligned as it was asked to be.
+        u64 alignment = (u64)block & (~(u64)block + 1);
+        return alignment < DYNA_ALLOC_MAX_ALIGNMENT ? alignment
+                                                    : DYNA_ALLOC_MAX_ALIGNMENT;
+    }
+    return header->padding > sizeof(memoryHeader) ? header->padding
+                                                  : FMEMORY_ALIGNMENT;
+}
+
+#ifdef GE_MEMORY_GUARD_PAGES
+// Maps enough pages for the block plus a PROT_NONE page after them. The block
+// is pushed to the end so running off it hits the guard page.
+// `padding` is the least space needed in front of the block and is set to the
+// real distance from the mapping to the block.
+static void* guardAlloc(u64 size, u64 alignment, u64* padding) {
+    u64 pageSize = platformGetPageSize();
+    u64 dataSize = (size + *padding + pageSize - 1) & ~(pageSize - 1);
+    void* raw = platformReserveMemory(dataSize + pageSize);
+    if (!raw) {
+        return 0;
+    }
+    if (!platformCommitMemory(raw, dataSize)) {
+        platformReleaseMemory(raw, dataSize + pageSize);
+        return 0;
+    }
+
+    // Only overruns past the alignment slack are caught
+    u64 mask = (alignment > FMEMORY_ALIGNMENT ? alignment : FMEMORY_ALIGNMENT) -
+               1;
+    *padding = (((u64)raw + dataSize - size) & ~mask) - (u64)raw;
+    return raw;
+}
+
+static void guardFree(void* raw, u64 rawSize) {
+    u64 pageSize = platformGetPageSize();
+    u64 dataSize = (rawSize + pageSize - 1) & ~(pageSize - 1);
+    platformReleaseMemory(raw, dataSize + pageSize);
+}
+#endif
+
+static void* cacheAlloc(u64 size);
+static b8 cacheFree(void* block, u64 size);
+static void* sharedAlloc(u64 size, u64 alignment);
+
+static u64 roundToCommit(u64 size) {
+    return (size + MEMORY_COMMIT_GRANULARITY - 1) &
+           ~((u64)MEMORY_COMMIT_GRANULARITY - 1);
+}
+
+// The reserved range never moves or shrinks so this doesn't need the lock
+static b8 ownsBlock(void* block) {
+    return block >= systemPtr->heapBlock &&
+           block < systemPtr->heapBlock + systemPtr->reserveSize;
+}
+
+#ifdef GE_MEMORY_TRACKING
+static u64 trackerHash(void* block) {
+    // Blocks are 16 aligned so the low bits carry nothing
+    u64 hash = (u64)block >> 4;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// Linear probe for `block`. Returns its slot or the empty slot it would go in
+static u64 trackerFind(memoryTrackedBlock* slots, u64 capacity, void* block) {
+    u64 mask = capacity - 1;
+    u64 i = trackerHash(block) & mask;
+    while (slots[i].block && slots[i].block != block) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static b8 trackerCreate(memoryTracker* tracker) {
+    tracker->capacity = MEMORY_TRACKER_START_CAPACITY;
+    tracker->count = 0;
+    tracker->slots = platformAllocatePages(sizeof(memoryTrackedBlock) *
+                                           tracker->capacity);
+    return tracker->slots && platformMutexCreate(&tracker->mutex);
+}
+
+static void trackerDestroy(memoryTracker* tracker) {
+    platformMutexDestroy(&tracker->mutex);
+    platformFreePages(tracker->slots,
+                      sizeof(memoryTrackedBlock) * tracker->capacity);
+    tracker->slots = 0;
+}
+
+// Doubles the table. Called with the tracker's lock held
+static b8 trackerGrow(memoryTracker* tracker) {
+    u64 capacity = tracker->capacity * 2;
+    memoryTrackedBlock* slots =
+        platformAllocatePages(sizeof(memoryTrackedBlock) * capacity);
+    if (!slots) {
+        return false;
+    }
+    for (u64 i = 0; i < tracker->capacity; ++i) {
+        if (tracker->slots[i].block) {
+            slots[trackerFind(slots, capacity, tracker->slots[i].block)] =
+                tracker->slots[i];
+        }
+    }
+    platformFreePages(tracker->slots,
+                      sizeof(memoryTrackedBlock) * tracker->capacity);
+    tracker->slots = slots;
+    tracker->capacity = capacity;
+    return true;
+}
+#endif
+
+// Remembers where `block` was allocated. Does nothing without tracking
+static void trackAdd(void* block, const char* file, u32 line) {
+#ifdef GE_MEMORY_TRACKING
+    memoryTracker* tracker = &systemPtr->tracker;
+    platformMutexLock(&tracker->mutex);
+    // Keep it at most half full so probes stay short
+    if ((tracker->count + 1) * 2 > tracker->capacity && !trackerGrow(tracker)) {
+        platformMutexUnlock(&tracker->mutex);
+        FWARN("Memory tracker is full, an allocation won't be tracked.");
+        return;
+    }
+    memoryTrackedBlock* slot =
+        &tracker->slots[trackerFind(tracker->slots, tracker->capacity, block)];
+    if (!slot->block) {
+        ++tracker->count;
+    }
+    slot->block = block;
+    slot->file = file ? file : "unknown";
+    slot->line = line;
+    slot->time = platformGetAbsoluteTime();
+    platformMutexUnlock(&tracker->mutex);
+#endif
+}
+
+// Forgets `block`. False if it wasn't live (e.g. a double free). Always true
+// without tracking
+static b8 trackRemove(void* block) {
+#ifdef GE_MEMORY_TRACKING
+    memoryTracker* tracker = &systemPtr->tracker;
+    platformMutexLock(&tracker->mutex);
+    memoryTrackedBlock* slots = tracker->slots;
+    u64 mask = tracker->capacity - 1;
+    u64 i = trackerFind(slots, tracker->capacity, block);
+    if (!slots[i].block) {
+        platformMutexUnlock(&tracker->mutex);
+        return false;
+    }
+    --tracker->count;
+
+    // Backward shift delete. Pulls later entries of the probe run into the
+    // hole so lookups never need tombstones.
+    for (;;) {
+        slots[i].block = 0;
+        u64 j = i;
+        for (;;) {
+            j = (j + 1) & mask;
+            if (!slots[j].block) {
+                platformMutexUnlock(&tracker->mutex);
+                return true;
+            }
+            // Entry can only move back if its home slot isn't in (i, j]
+            u64 home = trackerHash(slots[j].block) & mask;
+            b8 stays = i <= j ? (i < home && home <= j)
+                              : (i < home || home <= j);
+            if (!stays) {
+                break;
+            }
+        }
+        slots[i] = slots[j];
+        i = j;
+    }
+#else
+    return true;
+#endif
+}
 
 b8 memoryInit(MemorySystemSettings settings) {
-    u64 stateMemReq = sizeof(memorySystemState);
-    // Get the total memory required now
-    u64 dynaMemReq = 0;
-    dynaAllocCreate(settings.totalSize, &dynaMemReq, 0, 0);
+    if (!settings.reserveSize) {
+        settings.reserveSize = FMEMORY_DEFAULT_RESERVE_SIZE;
+    }
+    settings.totalSize = roundToCommit(settings.totalSize);
+    settings.reserveSize = roundToCommit(settings.reserveSize);
+    if (settings.totalSize == 0 || settings.totalSize > settings.reserveSize) {
+        FFATAL("MemoryInit needs a totalSize above 0 and up to reserveSize.");
+        return false;
+    }
 
-    // Since this is the memory system it can allocate it's own memory
-    void* block = platformAllocate(stateMemReq + dynaMemReq, false);
+    // Since this is the memory system it can allocate it's own memory. Pages
+    // are only committed once they are touched so this is cheap even for a
+    // huge pool.
+    void* block = platformAllocatePages(sizeof(memorySystemState));
     if (!block) {
         FFATAL("Failed to allocate memory.");
         return false;
@@ -51,21 +360,49 @@ b8 memoryInit(MemorySystemSettings settings) {
 
     systemPtr = (memorySystemState*)block;
     systemPtr->settings = settings;
-    systemPtr->allocatorMemReq = dynaMemReq;
+    systemPtr->reserveSize = settings.reserveSize;
 
     // Zero out stats
     platformZeroMemory(&systemPtr->stats, sizeof(systemPtr->stats));
+    platformZeroMemory(&systemPtr->frameStats, sizeof(systemPtr->frameStats));
+
+    systemPtr->heapBlock = platformReserveMemory(settings.reserveSize);
+    if (!systemPtr->heapBlock ||
+        !platformCommitMemory(systemPtr->heapBlock, settings.totalSize)) {
+        FFATAL("MemoryInit Failed to reserve the pool.");
+        return false;
+    }
 
-    systemPtr->allocatorBlock = ((void*)block + stateMemReq);
+    // Get the memory required for the freelist now
+    dynaAllocCreateWithBlock(settings.totalSize, &systemPtr->allocatorMemReq,
+                             0, 0, 0);
+    systemPtr->allocatorBlock =
+        platformAllocatePages(systemPtr->allocatorMemReq);
 
     // Actually create the dynamicAllocator
-    if (!dynaAllocCreate(settings.totalSize, &systemPtr->allocatorMemReq,
-                         systemPtr->allocatorBlock, &systemPtr->allocator)) {
+    if (!systemPtr->allocatorBlock ||
+        !dynaAllocCreateWithBlock(
+            settings.totalSize, &systemPtr->allocatorMemReq,
+            systemPtr->allocatorBlock, systemPtr->heapBlock,
+            &systemPtr->allocator)) {
         FFATAL("MemoryInit Failed to allocate a dynamicAllocator.");
         return false;
     }
 
-    FDEBUG("Memory System allocated %llu bytes", settings.totalSize);
+    if (!platformMutexCreate(&systemPtr->allocatorMutex)) {
+        FFATAL("MemoryInit Failed to create the allocator mutex.");
+        return false;
+    }
+
+#ifdef GE_MEMORY_TRACKING
+    if (!trackerCreate(&systemPtr->tracker)) {
+        FFATAL("MemoryInit Failed to create the allocation tracker.");
+        return false;
+    }
+#endif
+
+    FDEBUG("Memory System allocated %llu bytes (%llu reserved)",
+           settings.totalSize, settings.reserveSize);
     return true;
 }
 
@@ -74,62 +411,354 @@ void memoryShutdown() {
         FWARN("`memoryShutdown` called before `memoryInit`");
         return;
     }
+    // Other threads should have flushed their caches before exiting
+    memoryThreadCacheFlush();
+#ifdef GE_MEMORY_TRACKING
+    // Anything still live at this point is a leak
+    memoryReport();
+    trackerDestroy(&systemPtr->tracker);
+#endif
+    platformMutexDestroy(&systemPtr->allocatorMutex);
     dynaAllocDestroy(&systemPtr->allocator);
-    platformFree(systemPtr,
-                 systemPtr->allocatorMemReq + sizeof(memorySystemState));
+    platformFreePages(systemPtr->allocatorBlock, systemPtr->allocatorMemReq);
+    platformReleaseMemory(systemPtr->heapBlock, systemPtr->reserveSize);
+    platformFreePages(systemPtr, sizeof(memorySystemState));
     systemPtr = 0;
 }
 
-void* fmalloc(u64 size, MemoryTag tag) {
+// Commits more of the reserved range and grows the allocator into it so at
+// least `size` more bytes fit. Has to be called with the lock held.
+static b8 growPool(u64 size) {
+    dynaAllocator* alloc = &systemPtr->allocator;
+    u64 oldTotal = alloc->totalSize;
+    // Double it so growing stays rare
+    u64 newTotal = oldTotal * 2;
+    if (newTotal < oldTotal + size) {
+        newTotal = oldTotal + size;
+    }
+    newTotal = roundToCommit(newTotal);
+    if (newTotal > systemPtr->reserveSize) {
+        newTotal = systemPtr->reserveSize;
+    }
+    if (newTotal - oldTotal < size) {
+        FERROR("Memory pool can't grow past its reserved %llu bytes.",
+               systemPtr->reserveSize);
+        return false;
+    }
+
+    if (!platformCommitMemory(systemPtr->heapBlock + oldTotal,
+                              newTotal - oldTotal)) {
+        return false;
+    }
+
+    u64 memReq = 0;
+    dynaAllocGrow(alloc, newTotal, &memReq, 0, 0);
+    void* memory = platformAllocatePages(memReq);
+    if (!memory) {
+        return false;
+    }
+    void* oldMemory = 0;
+    if (!dynaAllocGrow(alloc, newTotal, &memReq, memory, &oldMemory)) {
+        platformFreePages(memory, memReq);
+        return false;
+    }
+    platformFreePages(oldMemory, systemPtr->allocatorMemReq);
+    systemPtr->allocatorBlock = memory;
+    systemPtr->allocatorMemReq = memReq;
+    systemPtr->settings.totalSize = newTotal;
+
+    FDEBUG("Memory pool grew to %llu bytes.", newTotal);
+    return true;
+}
+
+// Allocates from the shared allocator, growing it if it is full. Has to be
+// called with the lock held.
+static void* sharedAlloc(u64 size, u64 alignment) {
+    void* block = dynaAllocAligned(&systemPtr->allocator, size, alignment);
+    // Worst case the free space at the end doesn't help so ask for enough to
+    // align in the new space alone
+    if (!block && growPool(size + alignment)) {
+        block = dynaAllocAligned(&systemPtr->allocator, size, alignment);
+    }
+    return block;
+}
+
+// Raises `peak` to `value` if it's higher. Other threads might be doing the
+// same so it has to be a CAS loop.
+static void updatePeak(_Atomic u64* peak, u64 value) {
+    u64 current = atomic_load_explicit(peak, memory_order_relaxed);
+    while (value > current &&
+           !atomic_compare_exchange_weak_explicit(peak, &current, value,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+static void addStats(MemoryTag tag, u64 size) {
+    u64 total = atomic_fetch_add_explicit(&systemPtr->stats.totalMemAllocced,
+                                          size, memory_order_relaxed);
+    u64 tagTotal = atomic_fetch_add_explicit(
+        &systemPtr->stats.totalMemAllocsByTag[tag], size, memory_order_relaxed);
+    updatePeak(&systemPtr->stats.peakMemAllocced, total + size);
+    updatePeak(&systemPtr->stats.peakMemAllocsByTag[tag], tagTotal + size);
+}
+
+// Counts a new block. Kept apart from addStats so resizes aren't counted
+static void countAlloc(MemoryTag tag, u64 size) {
+    atomic_fetch_add_explicit(&systemPtr->stats.allocCount, 1,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&systemPtr->stats.allocCountByTag[tag], 1,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&systemPtr->stats.bytesAllocced, size,
+                              memory_order_relaxed);
+}
+
+static void countFree(MemoryTag tag) {
+    atomic_fetch_add_explicit(&systemPtr->stats.freeCount, 1,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&systemPtr->stats.freeCountByTag[tag], 1,
+                              memory_order_relaxed);
+}
+
+static void subStats(MemoryTag tag, u64 size) {
+    atomic_fetch_sub_explicit(&systemPtr->stats.totalMemAllocced, size,
+                              memory_order_relaxed);
+    atomic_fetch_sub_explicit(&systemPtr->stats.totalMemAllocsByTag[tag], size,
+                              memory_order_relaxed);
+}
+
+// Allocates `size` bytes plus a header and fills the header in
+static void* allocateBlock(u64 size, u64 alignment, MemoryTag tag) {
     // UNKNOWN can be used but probably shouldn't be
     if (tag == MEMORY_TAG_UNKNOWN) {
         FWARN("fallocate called using MEMORY_TAG_UNKNOWN.");
     }
 
-    void* block = 0;
+    // The header goes right in front of the user's block. For bigger
+    // alignments the whole first `alignment` bytes are skipped so the user's
+    // block stays aligned.
+    u64 padding = alignment > sizeof(memoryHeader) ? alignment
+                                                   : sizeof(memoryHeader);
+    void* raw = 0;
+    u16 flags = 0;
 
-    if (systemPtr) {
-        systemPtr->stats.totalMemAllocced += size;
-        systemPtr->stats.totalMemAllocsByTag[tag] += size;
+    if (!systemPtr) {
+        FERROR("fmalloc called before the memory system was inited.");
+        return 0;
+    }
 
-        block = dynaAlloc(&systemPtr->allocator, size);
+#ifdef GE_MEMORY_GUARD_PAGES
+    raw = guardAlloc(size, alignment, &padding);
+    flags |= MEMORY_HEADER_FLAG_GUARDED;
+#else
+    u64 rawSize = size + padding;
+    if (alignment > FMEMORY_ALIGNMENT) {
+        platformMutexLock(&systemPtr->allocatorMutex);
+        raw = sharedAlloc(rawSize, alignment);
+        platformMutexUnlock(&systemPtr->allocatorMutex);
+    } else {
+        raw = cacheAlloc(rawSize);
+    }
+#endif
+    if (!raw) {
+        FERROR("fmalloc failed to allocate %llu bytes.", size);
+        return 0;
+    }
+    addStats(tag, size);
+    countAlloc(tag, size);
+
+    void* block = raw + padding;
+    memoryHeader* header = getHeader(block);
+    header->size = size;
+    header->padding = (u32)padding;
+    header->tag = (u16)tag;
+    header->flags = flags;
+    return block;
+}
+
+void* fmalloc(u64 size, MemoryTag tag) {
+    return fmallocAt(size, FMEMORY_ALIGNMENT, tag, FMALLOC_FLAG_ZERO, 0, 0);
+}
+
+void* fmallocEx(u64 size, MemoryTag tag, u32 flags) {
+    return fmallocAt(size, FMEMORY_ALIGNMENT, tag, flags, 0, 0);
+}
+
+void* fmallocAligned(u64 size, u16 alignment, MemoryTag tag) {
+    return fmallocAt(size, alignment, tag, FMALLOC_FLAG_ZERO, 0, 0);
+}
+
+void* fmallocAt(u64 size, u16 alignment, MemoryTag tag, u32 flags,
+                const char* file, u32 line) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        FERROR("fmalloc: alignment must be a power of 2.");
+        return 0;
     }
 
-    // As a fallback incase the dynamicAllocator fails which it should never
-    // do
+    void* block = allocateBlock(size, alignment, tag);
     if (!block) {
-        FWARN("fmalloc called before memory system was inited or memory system "
-              "failed.");
-        block = platformAllocate(size, false);
+        return 0;
     }
+    trackAdd(block, file, line);
 
     // Zero out the memory so no old junk will confuse the user
-    platformZeroMemory(block, size);
+    if ((flags & FMALLOC_FLAG_ZERO) && !(flags & FMALLOC_FLAG_NO_ZERO)) {
+        platformZeroMemory(block, size);
+    } else {
+        poisonBlock(block, size, MEMORY_POISON_UNINIT);
+    }
     return block;
 }
 
-void ffree(void* block, u64 size, MemoryTag tag) {
-    // UNKNOWN can be used but probably shouldn't be
-    if (tag == MEMORY_TAG_UNKNOWN) {
-        FWARN("ffree called using MEMORY_TAG_UNKNOWN.");
+void* frealloc(void* block, u64 size) {
+    return freallocAt(block, size, 0, 0);
+}
+
+void* freallocAt(void* block, u64 size, const char* file, u32 line) {
+    if (!block) {
+        FERROR("frealloc needs a block. Use fmalloc for new blocks.");
+        return 0;
     }
 
+    memoryHeader* header = getHeader(block);
+    u64 oldSize = header->size;
     if (systemPtr) {
-        systemPtr->stats.totalMemAllocced -= size;
-        systemPtr->stats.totalMemAllocsByTag[tag] -= size;
+        // Try to shrink/grow where it is first. Only needs the freelist
+        void* raw = block - header->padding;
+        platformMutexLock(&systemPtr->allocatorMutex);
+        b8 resized = dynaAllocResize(&systemPtr->allocator, raw,
+                                     oldSize + header->padding,
+                                     size + header->padding);
+        platformMutexUnlock(&systemPtr->allocatorMutex);
+        if (resized) {
+            if (size < oldSize) {
+                poisonBlock(block + size, oldSize - size, MEMORY_POISON_FREED);
+            }
+            subStats(header->tag, oldSize);
+            addStats(header->tag, size);
+            header->size = size;
+            // Same block, the new call site owns it now
+            trackAdd(block, file, line);
+            return block;
+        }
+    }
+
+    // Couldn't do it in place. Move it
+    void* newBlock =
+        allocateBlock(size, getAlignment(header, block), header->tag);
+    if (!newBlock) {
+        return 0;
+    }
+    trackAdd(newBlock, file, line);
+    platformCopyMemory(newBlock, block, oldSize < size ? oldSize : size);
+    ffree(block);
+    return newBlock;
+}
 
-        b8 result = dynaAllocFree(&systemPtr->allocator, size, block);
+void ffree(void* block) {
+    if (!block) {
+        return;
+    }
+
+    if (!systemPtr) {
+        FERROR("ffree called before memoryInit or after memoryShutdown.");
+        return;
+    }
+#ifndef GE_MEMORY_GUARD_PAGES
+    // Check the address before reading the header, it might not be ours
+    if (!ownsBlock(block)) {
+        FERROR("ffree called on a block the memory system doesn't own.");
+        return;
+    }
+#endif
+    if (!trackRemove(block)) {
+        FERROR("ffree called on a block that isn't allocated. Double free?");
+        return;
+    }
+
+    memoryHeader* header = getHeader(block);
+    void* raw = block - header->padding;
+    subStats(header->tag, header->size);
+    countFree(header->tag);
+#ifdef GE_MEMORY_GUARD_PAGES
+    if (header->flags & MEMORY_HEADER_FLAG_GUARDED) {
+        guardFree(raw, header->size + header->padding);
+        return;
+    }
+#endif
+    poisonBlock(block, header->size, MEMORY_POISON_FREED);
+    cacheFree(raw, header->size + header->padding);
+}
 
-        // If result is false then that means something was allocated before the
-        // memory system was inited. Try to free it from the platform.
-        if (!result) {
-            // TODO: Memory alignment
-            platformFree(block, false);
+void memoryThreadCacheFlush() {
+    if (!systemPtr) {
+        return;
+    }
+    platformMutexLock(&systemPtr->allocatorMutex);
+    for (u32 bin = 0; bin < DYNA_ALLOC_BIN_COUNT; ++bin) {
+        memoryMagazine* mag = &threadCache.magazines[bin];
+        u64 binSize = dynaAllocBinSize(bin);
+        for (u32 i = 0; i < mag->count; ++i) {
+            dynaAllocFree(&systemPtr->allocator, binSize, mag->blocks[i]);
         }
-    } else {
-        // TODO: Memory alignment
-        platformFree(block, false);
+        mag->count = 0;
     }
+    platformMutexUnlock(&systemPtr->allocatorMutex);
+}
+
+static void* cacheAlloc(u64 size) {
+    u32 bin = dynaAllocBinIndex(size);
+    if (bin == INVALID_ID) {
+        // Too big to cache. Straight to the shared allocator.
+        platformMutexLock(&systemPtr->allocatorMutex);
+        void* block = sharedAlloc(size, FMEMORY_ALIGNMENT);
+        platformMutexUnlock(&systemPtr->allocatorMutex);
+        return block;
+    }
+
+    memoryMagazine* mag = &threadCache.magazines[bin];
+    if (mag->count == 0) {
+        // Refill half the magazine in one go so the lock is amortized
+        u64 binSize = dynaAllocBinSize(bin);
+        platformMutexLock(&systemPtr->allocatorMutex);
+        while (mag->count < MEMORY_MAGAZINE_CAPACITY / 2) {
+            void* block = sharedAlloc(binSize, FMEMORY_ALIGNMENT);
+            if (!block) {
+                break;
+            }
+            mag->blocks[mag->count++] = block;
+        }
+        platformMutexUnlock(&systemPtr->allocatorMutex);
+
+        if (mag->count == 0) {
+            return 0;
+        }
+    }
+    return mag->blocks[--mag->count];
+}
+
+static b8 cacheFree(void* block, u64 size) {
+    dynaAllocator* alloc = &systemPtr->allocator;
+    u32 bin = dynaAllocBinIndex(size);
+    if (bin == INVALID_ID) {
+        platformMutexLock(&systemPtr->allocatorMutex);
+        b8 result = dynaAllocFree(alloc, size, block);
+        platformMutexUnlock(&systemPtr->allocatorMutex);
+        return result;
+    }
+
+    memoryMagazine* mag = &threadCache.magazines[bin];
+    if (mag->count == MEMORY_MAGAZINE_CAPACITY) {
+        // Full. Give half back so the next few frees don't hit the lock
+        u64 binSize = dynaAllocBinSize(bin);
+        platformMutexLock(&systemPtr->allocatorMutex);
+        while (mag->count > MEMORY_MAGAZINE_CAPACITY / 2) {
+            dynaAllocFree(alloc, binSize, mag->blocks[--mag->count]);
+        }
+        platformMutexUnlock(&systemPtr->allocatorMutex);
+    }
+    mag->blocks[mag->count++] = block;
+    return true;
 }
 
 void* fzeroMemory(void* block, u64 size) {
@@ -144,33 +773,175 @@ void* fsetMem(void* dest, i32 value, u64 size) {
     return platformSetMemory(dest, value, size);
 }
 
-void printMemoryUsage() {
+MemoryStats memoryGetStats() {
+    MemoryStats out = {0};
+    if (!systemPtr) {
+        FERROR("memoryGetStats: Memory system has not been inited.")
+        return out;
+    }
+
+    memoryStats* stats = &systemPtr->stats;
+    out.totalAllocated =
+        atomic_load_explicit(&stats->totalMemAllocced, memory_order_relaxed);
+    out.peakAllocated =
+        atomic_load_explicit(&stats->peakMemAllocced, memory_order_relaxed);
+    out.allocCount =
+        atomic_load_explicit(&stats->allocCount, memory_order_relaxed);
+    out.freeCount =
+        atomic_load_explicit(&stats->freeCount, memory_order_relaxed);
+    for (u32 i = 0; i < MEMORY_TAG_MAX_TAGS; ++i) {
+        out.tags[i].current = atomic_load_explicit(
+            &stats->totalMemAllocsByTag[i], memory_order_relaxed);
+        out.tags[i].peak = atomic_load_explicit(&stats->peakMemAllocsByTag[i],
+                                                memory_order_relaxed);
+        out.tags[i].allocCount = atomic_load_explicit(
+            &stats->allocCountByTag[i], memory_order_relaxed);
+        out.tags[i].freeCount = atomic_load_explicit(
+            &stats->freeCountByTag[i], memory_order_relaxed);
+    }
+
+    // Only read under the lock since the pool grows under it
+    platformMutexLock(&systemPtr->allocatorMutex);
+    out.poolSize = systemPtr->allocator.totalSize;
+    platformMutexUnlock(&systemPtr->allocatorMutex);
+    out.reserveSize = systemPtr->reserveSize;
+
+    out.frameAllocCount = systemPtr->frameStats.allocCount;
+    out.frameFreeCount = systemPtr->frameStats.freeCount;
+    out.frameAllocBytes = systemPtr->frameStats.allocBytes;
+    out.peakFrameAllocCount = systemPtr->frameStats.peakAllocCount;
+    return out;
+}
+
+void memoryFrameEnd() {
     if (!systemPtr) {
-        FERROR("printMemoryUsage: Memory system has not been inited.")
         return;
     }
+
+    memoryFrameStats* frame = &systemPtr->frameStats;
+    u64 allocCount = atomic_load_explicit(&systemPtr->stats.allocCount,
+                                          memory_order_relaxed);
+    u64 freeCount = atomic_load_explicit(&systemPtr->stats.freeCount,
+                                         memory_order_relaxed);
+    u64 bytesAllocced = atomic_load_explicit(&systemPtr->stats.bytesAllocced,
+                                             memory_order_relaxed);
+
+    frame->allocCount = allocCount - frame->lastAllocCount;
+    frame->freeCount = freeCount - frame->lastFreeCount;
+    frame->allocBytes = bytesAllocced - frame->lastBytesAllocced;
+    if (frame->allocCount > frame->peakAllocCount) {
+        frame->peakAllocCount = frame->allocCount;
+    }
+
+    frame->lastAllocCount = allocCount;
+    frame->lastFreeCount = freeCount;
+    frame->lastBytesAllocced = bytesAllocced;
+}
+
+// Scales `bytes` to the biggest unit that keeps it at least 1
+static const char* getUnit(u64 bytes, f32* outAmount) {
     const u64 gib = 1073741824; // 1024 * 1024 * 1024
     const u64 mib = 1048576;    // 1024 * 1024
     const u64 kib = 1024;
 
-    for (u32 i = 0; i < MEMORY_TAG_MAX_TAGS; ++i) {
-        char unit[4] = "XiB";
-        float amount = 1.0f;
-        if (systemPtr->stats.totalMemAllocsByTag[i] >= gib) {
-            unit[0] = 'G';
-            amount = systemPtr->stats.totalMemAllocsByTag[i] / (float)gib;
-        } else if (systemPtr->stats.totalMemAllocsByTag[i] >= mib) {
-            unit[0] = 'M';
-            amount = systemPtr->stats.totalMemAllocsByTag[i] / (float)mib;
-        } else if (systemPtr->stats.totalMemAllocsByTag[i] >= kib) {
-            unit[0] = 'K';
-            amount = systemPtr->stats.totalMemAllocsByTag[i] / (float)kib;
-        } else {
-            unit[0] = 'B';
-            unit[1] = 0;
-            amount = (float)systemPtr->stats.totalMemAllocsByTag[i];
-        }
+    if (bytes >= gib) {
+        *outAmount = bytes / (f32)gib;
+        return "GiB";
+    } else if (bytes >= mib) {
+        *outAmount = bytes / (f32)mib;
+        return "MiB";
+    } else if (bytes >= kib) {
+        *outAmount = bytes / (f32)kib;
+        return "KiB";
+    }
+    *outAmount = (f32)bytes;
+    return "B";
+}
 
+void printMemoryUsage() {
+    if (!systemPtr) {
+        FERROR("printMemoryUsage: Memory system has not been inited.")
+        return;
+    }
+
+    for (u32 i = 0; i < MEMORY_TAG_MAX_TAGS; ++i) {
+        f32 amount = 0;
+        const char* unit = getUnit(
+            atomic_load_explicit(&systemPtr->stats.totalMemAllocsByTag[i],
+                                 memory_order_relaxed),
+            &amount);
         printf("  %-20s: %.3f%s\n", TAG_STRING[i], amount, unit);
     }
 }
+
+void memoryReport() {
+    if (!systemPtr) {
+        FERROR("memoryReport: Memory system has not been inited.")
+        return;
+    }
+
+    f32 amount = 0;
+    f32 peakAmount = 0;
+    const char* unit = 0;
+    const char* peakUnit = 0;
+
+    MemoryStats stats = memoryGetStats();
+
+    printf("Memory report\n");
+    printf("  %-22s  %-13s  %-13s  %-10s  %-10s\n", "Tag", "Current", "Peak",
+           "Allocs", "Frees");
+    for (u32 i = 0; i < MEMORY_TAG_MAX_TAGS; ++i) {
+        unit = getUnit(stats.tags[i].current, &amount);
+        peakUnit = getUnit(stats.tags[i].peak, &peakAmount);
+        printf("  %-22s: %10.3f%-3s  %10.3f%-3s  %10llu  %10llu\n",
+               TAG_STRING[i], amount, unit, peakAmount, peakUnit,
+               stats.tags[i].allocCount, stats.tags[i].freeCount);
+    }
+    unit = getUnit(stats.totalAllocated, &amount);
+    peakUnit = getUnit(stats.peakAllocated, &peakAmount);
+    printf("  %-22s: %10.3f%-3s  %10.3f%-3s  %10llu  %10llu\n", "TOTAL", amount,
+           unit, peakAmount, peakUnit, stats.allocCount, stats.freeCount);
+
+    // Fragmentation. Only the freelist counts, binned blocks are shown apart
+    // and blocks in thread caches count as used.
+    platformMutexLock(&systemPtr->allocatorMutex);
+    u64 poolSize = systemPtr->allocator.totalSize;
+    u64 binnedSize = systemPtr->allocator.binnedSize;
+    u64 freeSpace = freelistFreeSpace(&systemPtr->allocator.list);
+    u64 largest = freelistLargestBlock(&systemPtr->allocator.list);
+    u64 nodeCount = freelistNodeCount(&systemPtr->allocator.list);
+    platformMutexUnlock(&systemPtr->allocatorMutex);
+
+    unit = getUnit(poolSize, &amount);
+    peakUnit = getUnit(systemPtr->reserveSize, &peakAmount);
+    printf("  Pool: %.3f%s committed of %.3f%s reserved\n", amount, unit,
+           peakAmount, peakUnit);
+    unit = getUnit(freeSpace, &amount);
+    peakUnit = getUnit(largest, &peakAmount);
+    // 0% means all the free space is one block
+    f32 fragmentation =
+        freeSpace ? (1.0f - largest / (f32)freeSpace) * 100.0f : 0.0f;
+    printf("  Free: %.3f%s in %llu ranges, largest %.3f%s (%.1f%% "
+           "fragmented)\n",
+           amount, unit, nodeCount, peakAmount, peakUnit, fragmentation);
+    unit = getUnit(binnedSize, &amount);
+    printf("  Binned: %.3f%s\n", amount, unit);
+
+#ifdef GE_MEMORY_TRACKING
+    memoryTracker* tracker = &systemPtr->tracker;
+    platformMutexLock(&tracker->mutex);
+    f64 now = platformGetAbsoluteTime();
+    printf("  %llu live allocations\n", tracker->count);
+    for (u64 i = 0; i < tracker->capacity; ++i) {
+        memoryTrackedBlock* slot = &tracker->slots[i];
+        if (!slot->block) {
+            continue;
+        }
+        memoryHeader* header = getHeader(slot->block);
+        printf("    %s:%u  %llu bytes  %s  %.2fs ago\n", slot->file,
+               slot->line, header->size, TAG_STRING[header->tag],
+               now - slot->time);
+    }
+    platformMutexUnlock(&tracker->mutex);
+#endif
+}
@@ -15,6 +15,7 @@
     TAG(MEMORY_TAG_TEXTURE)                                                    \
     TAG(MEMORY_TAG_STRING)                                                     \
     TAG(MEMORY_TAG_SYSTEM)                                                     \
+    TAG(MEMORY_TAG_HASHMAP)                                                    \
     TAG(MEMORY_TAG_MAX_TAGS)
 
 #define GENERATE_ENUM(ENUM) ENUM,
@@ -24,10 +25,58 @@ typedef enum MemoryTag { FOREACH_TAG(GENERATE_ENUM) } MemoryTag;
 
 static const char* TAG_STRING[] = {FOREACH_TAG(GENERATE_STRING)};
 
+// Every block handed out by the memory system is at least this aligned
+#define FMEMORY_ALIGNMENT 16
+
+typedef enum MemoryFlags {
+    FMALLOC_FLAG_NONE = 0x0,
+    /** @brief Zero the block before returning it. What `fmalloc` does */
+    FMALLOC_FLAG_ZERO = 0x1,
+    /** @brief Skip zeroing. For blocks that get overwritten right away.
+     * Wins over FMALLOC_FLAG_ZERO */
+    FMALLOC_FLAG_NO_ZERO = 0x2,
+    /** @brief Block must be FMEMORY_ALIGNMENT aligned (e.g. SIMD types) */
+    FMALLOC_FLAG_ALIGNED = 0x4
+} MemoryFlags;
+
+// Address space reserved for the pool when `reserveSize` is 0
+#define FMEMORY_DEFAULT_RESERVE_SIZE GIBIBYTES(64ULL)
+
 typedef struct MemorySystemSettings {
+    // Size of the pool at startup. It grows when it runs out
     u64 totalSize;
+    // Most the pool can ever grow to. Only address space, 0 for the default
+    u64 reserveSize;
 } MemorySystemSettings;
 
+typedef struct MemoryTagStats {
+    // Bytes allocated right now
+    u64 current;
+    // Highest `current` has been
+    u64 peak;
+    u64 allocCount;
+    u64 freeCount;
+} MemoryTagStats;
+
+// Snapshot of the memory system from `memoryGetStats`. Cheap enough to grab
+// every frame.
+typedef struct MemoryStats {
+    u64 totalAllocated;
+    u64 peakAllocated;
+    u64 allocCount;
+    u64 freeCount;
+    MemoryTagStats tags[MEMORY_TAG_MAX_TAGS];
+    // Committed pool size and the most it can grow to
+    u64 poolSize;
+    u64 reserveSize;
+    // Traffic during the last finished frame (see `memoryFrameEnd`)
+    u64 frameAllocCount;
+    u64 frameFreeCount;
+    u64 frameAllocBytes;
+    // Most allocations any frame has made so far
+    u64 peakFrameAllocCount;
+} MemoryStats;
+
 /**
  * @brief Sets up the memory system. This system will be used to perform most
  * application memory allocations. Does NOT need to be called twice (Unlike most
@@ -43,7 +92,8 @@ CT_API b8 memoryInit(MemorySystemSettings settings);
 CT_API void memoryShutdown();
 
 /**
- * @brief Allocates memory. (Doesn't actually perform a malloc);
+ * @brief Allocates memory. (Doesn't actually perform a malloc); Safe to call
+ * from any thread.
  * @param size Size of the block of memory needed
  * @param tag Memory tag used for debugging purposes to see memory leaks
  * @returns pointer to a block of memory, 0 if failed and outputs an error
@@ -52,14 +102,51 @@ CT_API void memoryShutdown();
 CT_API void* fmalloc(u64 size, MemoryTag tag);
 
 /**
- * @brief Frees a block of memory
- * @param block Pointer to the memory block
- * @param size Size of the block of memory needed to be freed
+ * @brief Allocates memory with `MemoryFlags`. Only zeroes the block if
+ * FMALLOC_FLAG_ZERO is passed.
+ * @param size Size of the block of memory needed
+ * @param tag Memory tag used for debugging purposes to see memory leaks
+ * @param flags MemoryFlags OR'd together
+ * @returns pointer to a block of memory, 0 if failed and outputs an error
+ * message
+ */
+CT_API void* fmallocEx(u64 size, MemoryTag tag, u32 flags);
+
+/**
+ * @brief Allocates a zeroed block aligned to `alignment`. Free it with `ffree`
+ * like any other block.
+ * @param size Size of the block of memory needed
+ * @param alignment Power of 2 alignment. Up to 4096 (a page)
  * @param tag Memory tag used for debugging purposes to see memory leaks
  * @returns pointer to a block of memory, 0 if failed and outputs an error
  * message
  */
-CT_API void ffree(void* block, u64 size, MemoryTag tag);
+CT_API void* fmallocAligned(u64 size, u16 alignment, MemoryTag tag);
+
+/**
+ * @brief Resizes a block. Grows/shrinks it in place when it can, otherwise
+ * moves it and frees the old block. New bytes are NOT zeroed.
+ * @param block Pointer to a block from fmalloc/fmallocEx/fmallocAligned
+ * @param size The new size of the block
+ * @returns pointer to the (maybe moved) block, 0 if failed. The old block is
+ * still valid if it failed.
+ */
+CT_API void* frealloc(void* block, u64 size);
+
+/**
+ * @brief Frees a block of memory. Safe to call from any thread, including one
+ * that didn't allocate the block. The size & tag are remembered by the memory
+ * system.
+ * @param block Pointer to the memory block. Can be 0/NULL
+ */
+CT_API void ffree(void* block);
+
+/**
+ * @brief Gives every block cached by the calling thread back to the shared
+ * allocator. Worker threads should call this before they exit or their cached
+ * blocks are lost until shutdown.
+ */
+CT_API void memoryThreadCacheFlush();
 
 /**
  * @brief Zeros out a block of memory
@@ -87,7 +174,53 @@ CT_API void* fcpyMem(void* dest, const void* source, u64 size);
  */
 CT_API void* fsetMem(void* dest, i32 value, u64 size);
 
+/**
+ * @brief Gets a snapshot of the memory stats. Safe to call from any thread.
+ * Counters are read one by one, so a snapshot taken while other threads
+ * allocate can be a little out of sync with itself.
+ */
+CT_API MemoryStats memoryGetStats();
+
+/**
+ * @brief Closes out the current frame's allocation counts so they show up in
+ * `MemoryStats.frame...`. Called once a frame by the engine.
+ */
+CT_API void memoryFrameEnd();
+
 /**
  * @brief Prints the Memory Tags for debugging purposes
  */
 CT_API void printMemoryUsage();
+
+/**
+ * @brief Prints current/peak usage per tag and how fragmented the pool is.
+ * With GE_MEMORY_TRACKING it also lists every live allocation with the
+ * file/line that made it. Runs at `memoryShutdown` in tracking builds.
+ */
+CT_API void memoryReport();
+
+/**
+ * @brief What the allocation macros call in GE_MEMORY_TRACKING builds. Same
+ * as `fmallocEx`/`fmallocAligned` but remembers `file` and `line`. Without
+ * tracking the call site is ignored.
+ */
+CT_API void* fmallocAt(u64 size, u16 alignment, MemoryTag tag, u32 flags,
+                       const char* file, u32 line);
+
+/**
+ * @brief Same as `frealloc` but remembers `file` and `line`
+ */
+CT_API void* freallocAt(void* block, u64 size, const char* file, u32 line);
+
+// Tracking builds route every allocation through the `...At` versions so the
+// call site is known. fmemory.c defines the real functions so it skips these.
+#if defined(GE_MEMORY_TRACKING) && !defined(FMEMORY_IMPLEMENTATION)
+#define fmalloc(size, tag)                                                     \
+    fmallocAt(size, FMEMORY_ALIGNMENT, tag, FMALLOC_FLAG_ZERO, __FILE__,       \
+              __LINE__)
+#define fmallocEx(size, tag, flags)                                            \
+    fmallocAt(size, FMEMORY_ALIGNMENT, tag, flags, __FILE__, __LINE__)
+#define fmallocAligned(size, alignment, tag)                                   \
+    fmallocAt(size, alignment, tag, FMALLOC_FLAG_ZERO, __FILE__, __LINE__)
+#define frealloc(block, size) freallocAt(block, size, __FILE__, __LINE__)
+#endif
@@ -2,23 +2,19 @@
 #include "core/systems/event.h"
 #include "core/systems/fmemory.h"
 #include "core/systems/logger.h"
+#include "helpers/bitset.h"
 
-typedef struct keyState {
-    b8 isDown;
-} keyState;
+#define INPUT_KEY_WORDS BITSET_WORDS(256)
 
+// One bit per key/button, set while it's down
 typedef struct keyboardState {
-    keyState keys[256];
+    u64 keys[INPUT_KEY_WORDS];
 } keyboardState;
 
-typedef struct buttonState {
-    b8 isDown;
-} buttonState;
-
 typedef struct mouseState {
     i16 x;
     i16 y;
-    buttonState buttons[BUTTON_MAX_BUTTONS];
+    u64 buttons[BITSET_WORDS(BUTTON_MAX_BUTTONS)];
 } mouseState;
 
 typedef struct inputState {
@@ -58,10 +54,10 @@ void inputShutdown(void* state) {
 void inputProcessKey(GE_Keys key, b8 pressed) {
     EventContext context;
     context.data.u16[0] = key;
-    systemPtr->keyboardCur.keys[key].isDown = pressed;
+    bitsPut(systemPtr->keyboardCur.keys, key, pressed);
 
-    if (systemPtr->keyboardCur.keys[key].isDown !=
-        systemPtr->keyboardPrev.keys[key].isDown) {
+    if (bitsTest(systemPtr->keyboardCur.keys, key) !=
+        bitsTest(systemPtr->keyboardPrev.keys, key)) {
         eventFire(pressed ? EVENT_CODE_KEY_PRESSED : EVENT_CODE_KEY_RELEASED, 0,
                   context);
     } else {
@@ -72,9 +68,9 @@ void inputProcessKey(GE_Keys key, b8 pressed) {
 void inputProcessButton(GE_Buttons button, b8 pressed) {
     EventContext context;
     context.data.u16[0] = button;
-    systemPtr->mouseCur.buttons[button].isDown = pressed;
-    if (systemPtr->mouseCur.buttons[button].isDown !=
-        systemPtr->mousePrev.buttons[button].isDown) {
+    bitsPut(systemPtr->mouseCur.buttons, button, pressed);
+    if (bitsTest(systemPtr->mouseCur.buttons, button) !=
+        bitsTest(systemPtr->mousePrev.buttons, button)) {
         eventFire(pressed ? EVENT_CODE_BUTTON_PRESSED
                           : EVENT_CODE_BUTTON_RELEASED,
                   0, context);
@@ -92,7 +88,8 @@ void inputProcessMouseMove(i16 x, i16 y) {
         EventContext context;
         context.data.u16[0] = x;
         context.data.u16[1] = y;
-        eventFire(EVENT_CODE_MOUSE_MOVED, 0, context);
+        // Motion comes in bursts. Listeners get the last one of the frame
+        eventPost(EVENT_CODE_MOUSE_MOVED, 0, context);
     }
 }
 
@@ -107,7 +104,7 @@ b8 inputIsKeyDown(GE_Keys key) {
         FERROR("Input system is not inited");
         return false;
     }
-    return systemPtr->keyboardCur.keys[key].isDown;
+    return bitsTest(systemPtr->keyboardCur.keys, key);
 }
 
 b8 inputIsKeyUp(GE_Keys key) {
@@ -115,7 +112,7 @@ b8 inputIsKeyUp(GE_Keys key) {
         FERROR("Input system is not inited");
         return true;
     }
-    return !systemPtr->keyboardCur.keys[key].isDown;
+    return !bitsTest(systemPtr->keyboardCur.keys, key);
 }
 
 b8 inputIsKeyReleased(GE_Keys key) {
@@ -123,9 +120,9 @@ b8 inputIsKeyReleased(GE_Keys key) {
         FERROR("Input system is not inited");
         return false;
     }
-    return ((systemPtr->keyboardPrev.keys[key].isDown !=
-             systemPtr->keyboardCur.keys[key].isDown) &&
-            !systemPtr->keyboardCur.keys[key].isDown);
+    return ((bitsTest(systemPtr->keyboardPrev.keys, key) !=
+             bitsTest(systemPtr->keyboardCur.keys, key)) &&
+            !bitsTest(systemPtr->keyboardCur.keys, key));
 }
 
 b8 inputIsKeyPressed(GE_Keys key) {
@@ -133,17 +130,17 @@ b8 inputIsKeyPressed(GE_Keys key) {
         FERROR("Input system is not inited");
         return false;
     }
-    return ((systemPtr->keyboardPrev.keys[key].isDown !=
-             systemPtr->keyboardCur.keys[key].isDown) &&
-            systemPtr->keyboardCur.keys[key].isDown);
+    return ((bitsTest(systemPtr->keyboardPrev.keys, key) !=
+             bitsTest(systemPtr->keyboardCur.keys, key)) &&
+            bitsTest(systemPtr->keyboardCur.keys, key));
 }
 
-b8 inputWasKeyPressed(GE_Keys key) {
+b8 inputWasKeyDown(GE_Keys key) {
     if (!systemPtr) {
         FERROR("Input system is not inited");
         return false;
     }
-    return systemPtr->keyboardPrev.keys[key].isDown;
+    return bitsTest(systemPtr->keyboardPrev.keys, key);
 }
 
 b8 inputWasKeyUp(GE_Keys key) {
@@ -151,7 +148,7 @@ b8 inputWasKeyUp(GE_Keys key) {
         FERROR("Input system is not inited");
         return true;
     }
-    return !systemPtr->keyboardPrev.keys[key].isDown;
+    return !bitsTest(systemPtr->keyboardPrev.keys, key);
 }
 
 // mouse input
@@ -160,9 +157,9 @@ b8 inputIsButtonPressed(GE_Buttons button) {
         FERROR("Input system is not inited");
         return false;
     }
-    return ((systemPtr->mouseCur.buttons[button].isDown !=
-             systemPtr->mousePrev.buttons[button].isDown) &&
-            systemPtr->mouseCur.buttons[button].isDown);
+    return ((bitsTest(systemPtr->mouseCur.buttons, button) !=
+             bitsTest(systemPtr->mousePrev.buttons, button)) &&
+            bitsTest(systemPtr->mouseCur.buttons, button));
 }
 
 b8 inputIsButtonReleased(GE_Buttons button) {
@@ -170,9 +167,9 @@ b8 inputIsButtonReleased(GE_Buttons button) {
         FERROR("Input system is not inited");
         return false;
     }
-    return ((systemPtr->mouseCur.buttons[button].isDown !=
-             systemPtr->mousePrev.buttons[button].isDown) &&
-            !systemPtr->mouseCur.buttons[button].isDown);
+    return ((bitsTest(systemPtr->mouseCur.buttons, button) !=
+             bitsTest(systemPtr->mousePrev.buttons, button)) &&
+            !bitsTest(systemPtr->mouseCur.buttons, button));
 }
 
 b8 inputIsButtonUp(GE_Buttons button) {
@@ -180,7 +177,7 @@ b8 inputIsButtonUp(GE_Buttons button) {
         FERROR("Input system is not inited");
         return true;
     }
-    return !systemPtr->mouseCur.buttons[button].isDown;
+    return !bitsTest(systemPtr->mouseCur.buttons, button);
 }
 
 b8 inputIsButtonDown(GE_Buttons button) {
@@ -188,15 +185,15 @@ b8 inputIsButtonDown(GE_Buttons button) {
         FERROR("Input system is not inited");
         return true;
     }
-    return systemPtr->mouseCur.buttons[button].isDown;
+    return bitsTest(systemPtr->mouseCur.buttons, button);
 }
 
-b8 inputWasButtonPressed(GE_Buttons button) {
+b8 inputWasButtonDown(GE_Buttons button) {
     if (!systemPtr) {
         FERROR("Input system is not inited");
         return false;
     }
-    return systemPtr->mousePrev.buttons[button].isDown;
+    return bitsTest(systemPtr->mousePrev.buttons, button);
 }
 
 b8 inputWasButtonUp(GE_Buttons button) {
@@ -204,7 +201,38 @@ b8 inputWasButtonUp(GE_Buttons button) {
         FERROR("Input system is not inited");
         return true;
     }
-    return !systemPtr->mousePrev.buttons[button].isDown;
+    return !bitsTest(systemPtr->mousePrev.buttons, button);
+}
+
+u32 inputGetChangedKeys(GE_Keys* outKeys, u32 maxKeys) {
+    if (!systemPtr) {
+        FERROR("Input system is not inited");
+        return 0;
+    }
+    u64 changed[INPUT_KEY_WORDS];
+    bitsXor(changed, systemPtr->keyboardCur.keys, systemPtr->keyboardPrev.keys,
+            INPUT_KEY_WORDS);
+
+    u32 count = 0;
+    u64 key = bitsFindFirstSet(changed, INPUT_KEY_WORDS, 0);
+    while (key != BITSET_NOT_FOUND && count < maxKeys) {
+        outKeys[count++] = (GE_Keys)key;
+        key = bitsFindFirstSet(changed, INPUT_KEY_WORDS, key + 1);
+    }
+    return count;
+}
+
+b8 inputAnyKeyChanged() {
+    if (!systemPtr) {
+        FERROR("Input system is not inited");
+        return false;
+    }
+    for (u32 i = 0; i < INPUT_KEY_WORDS; ++i) {
+        if (systemPtr->keyboardCur.keys[i] != systemPtr->keyboardPrev.keys[i]) {
+            return true;
+        }
+    }
+    return false;
 }
 
 void inputGetMousePosition(i32* x, i32* y) {
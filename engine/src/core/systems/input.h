@@ -155,6 +155,16 @@ CT_API b8 inputWasKeyUp(GE_Keys key);
 CT_API b8 inputIsKeyReleased(GE_Keys key);
 CT_API b8 inputIsKeyPressed(GE_Keys key);
 
+/**
+ * @brief Gets the keys that went down or up since last frame, lowest first.
+ * @param outKeys Filled with up to `maxKeys` keys
+ * @returns how many keys were written
+ */
+CT_API u32 inputGetChangedKeys(GE_Keys* outKeys, u32 maxKeys);
+
+// True if any key went down or up since last frame
+CT_API b8 inputAnyKeyChanged();
+
 void inputProcessKey(GE_Keys key, b8 pressed);
 
 // mouse input
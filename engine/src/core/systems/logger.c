@@ -1,4 +1,5 @@
 #include "logger.h"
+#include "helpers/ringQueue.h"
 #include "platform/filesystem.h"
 #include "platform/platform.h"
 
@@ -6,30 +7,90 @@
 #include <stdio.h>
 #include <string.h>
 
+// Messages for the log file are queued in entries of this size and written
+// in batches by `loggerFlush`. Longer ones are written straight away
+#define LOG_ENTRY_SIZE 256
+#define LOG_QUEUE_CAPACITY 1024
+#define LOG_FLUSH_BATCH_SIZE KIBIBYTES(16)
+
+typedef struct logEntry {
+    u32 length;
+    char text[LOG_ENTRY_SIZE - sizeof(u32)];
+} logEntry;
+
 typedef struct loggerState {
-    char* logQueue;
-    u64 fileLogQueueCnt;
+    // Queue of logEntry. Its memory is right after this struct
+    mpmcQueue logQueue;
     FileHandle fileHandle;
+    // Held while popping and writing so concurrent flushes (and the direct
+    // writes of long messages) land in the file in order
+    PlatformMutex writeMutex;
 } loggerState;
 
 static loggerState* systemPtr;
 
-void sendTextToFile(const char* m) {
-    // TODO: Make this use a queue
-    u64 l = strlen(m);
+static void writeToFile(const char* text, u64 length) {
     u64 written = 0;
-    if (!fsWrite(&systemPtr->fileHandle, l, m, &written)) {
+    if (!fsWrite(&systemPtr->fileHandle, length, text, &written)) {
         FERROR("Failed to write to log file");
     }
 }
 
+// Needs writeMutex held
+static void flushQueue() {
+    // Batch the queued entries so the file gets a few big writes
+    char batch[LOG_FLUSH_BATCH_SIZE];
+    u64 batchLength = 0;
+    logEntry entry;
+    while (mpmcQueuePop(&systemPtr->logQueue, &entry)) {
+        if (batchLength + entry.length > sizeof(batch)) {
+            writeToFile(batch, batchLength);
+            batchLength = 0;
+        }
+        memcpy(batch + batchLength, entry.text, entry.length);
+        batchLength += entry.length;
+    }
+    if (batchLength) {
+        writeToFile(batch, batchLength);
+    }
+}
+
+void sendTextToFile(const char* m) {
+    if (!systemPtr) {
+        return;
+    }
+    u64 l = strlen(m);
+    if (l <= sizeof(((logEntry*)0)->text)) {
+        logEntry entry;
+        entry.length = (u32)l;
+        memcpy(entry.text, m, l);
+        if (mpmcQueuePush(&systemPtr->logQueue, &entry)) {
+            return;
+        }
+    }
+    // Too long or the queue is full. Write out what's queued first so the
+    // file stays in order
+    platformMutexLock(&systemPtr->writeMutex);
+    flushQueue();
+    writeToFile(m, l);
+    platformMutexUnlock(&systemPtr->writeMutex);
+}
+
 b8 loggerInit(u64* memoryRequirement, void* state) {
-    *memoryRequirement = sizeof(loggerState);
+    u64 queueMemReq = 0;
+    mpmcQueueCreate(sizeof(logEntry), LOG_QUEUE_CAPACITY, &queueMemReq, 0, 0);
+    *memoryRequirement = sizeof(loggerState) + queueMemReq;
     if (state == 0) {
         return true;
     }
     systemPtr = state;
+    mpmcQueueCreate(sizeof(logEntry), LOG_QUEUE_CAPACITY, &queueMemReq,
+                    (u8*)state + sizeof(loggerState), &systemPtr->logQueue);
 
+    if (!platformMutexCreate(&systemPtr->writeMutex)) {
+        FERROR("Couldn't create the log file mutex.");
+        return false;
+    }
     if (!fsOpen("appLogger.log", FILE_MODE_WRITE, false,
                 &systemPtr->fileHandle)) {
         FERROR("Couldn't open appLogger.log to write logs.");
@@ -39,8 +100,22 @@ b8 loggerInit(u64* memoryRequirement, void* state) {
 }
 
 void loggerShutdown() {
+    if (!systemPtr) {
+        return;
+    }
+    loggerFlush();
+    fsClose(&systemPtr->fileHandle);
+    platformMutexDestroy(&systemPtr->writeMutex);
     systemPtr = 0;
-    // TODO: cleanup logging/write queued entries.
+}
+
+void loggerFlush() {
+    if (!systemPtr) {
+        return;
+    }
+    platformMutexLock(&systemPtr->writeMutex);
+    flushQueue();
+    platformMutexUnlock(&systemPtr->writeMutex);
 }
 
 void logToFile(logLevel level, b8 logToConsole, const char* message, ...) {
@@ -25,6 +25,13 @@ typedef enum logLevel {
 b8 loggerInit(u64* memoryRequirement, void* state);
 void loggerShutdown();
 
+/**
+ * @brief Writes the queued `logToFile` messages to the log file. Called once a
+ * frame and on shutdown. Safe from any thread, concurrent flushes are
+ * serialized so lines stay in order.
+ */
+void loggerFlush();
+
 // TODO: Actually log it to the file
 CT_API void logToFile(logLevel level, b8 logToConsole, const char* message,
                       ...);
@@ -0,0 +1,181 @@
+#include "core/systems/stringTable.h"
+#include "core/linearAllocator.h"
+#include "core/systems/fmemory.h"
+#include "core/systems/logger.h"
+#include "helpers/dinoarray.h"
+#include "helpers/hashmap.h"
+
+#include <string.h>
+
+// Strings are copied into chunks of this size. Longer strings get a chunk of
+// their own
+#define STRING_TABLE_CHUNK_SIZE KIBIBYTES(16)
+#define STRING_TABLE_INITIAL_CAPACITY 256
+
+typedef struct internedString {
+    const char* str;
+    u64 hash;
+    u64 length;
+} internedString;
+
+DINO_DEFINE(internedString)
+DINO_DEFINE(linearAllocator)
+
+typedef struct stringTableState {
+    // Stored string -> stringId
+    hashmap lookup;
+    // Indexed by stringId
+    internedString* strings;
+    // Storage for the copies. Only the last chunk is appended to
+    linearAllocator* chunks;
+} stringTableState;
+
+static stringTableState* systemPtr;
+
+b8 stringTableInit(u64* memoryRequirement, void* state) {
+    *memoryRequirement = sizeof(stringTableState);
+    if (state == 0) {
+        return true;
+    }
+    systemPtr = state;
+
+    if (!hashmapCreate(sizeof(stringId), STRING_TABLE_INITIAL_CAPACITY, true,
+                       &systemPtr->lookup)) {
+        FERROR("Failed to create the string table's hashmap.");
+        systemPtr = 0;
+        return false;
+    }
+    systemPtr->strings =
+        dinoCreateReserve(STRING_TABLE_INITIAL_CAPACITY, internedString);
+    systemPtr->chunks = dinoCreate(linearAllocator);
+
+    FINFO("String table inited");
+    return true;
+}
+
+void stringTableShutdown() {
+    if (!systemPtr) {
+        FERROR("String table was called before it was inited.")
+        return;
+    }
+
+    u64 chunkCount = dinoLength(systemPtr->chunks);
+    for (u64 i = 0; i < chunkCount; ++i) {
+        ffree(systemPtr->chunks[i].memory);
+    }
+    dinoDestroy(systemPtr->chunks);
+    dinoDestroy(systemPtr->strings);
+    hashmapDestroy(&systemPtr->lookup);
+    systemPtr = 0;
+}
+
+// Copies `str` into the last chunk, starting a new chunk if it doesn't fit
+static char* storeString(const char* str, u64 length) {
+    u64 size = length + 1;
+    u64 chunkCount = dinoLength(systemPtr->chunks);
+    linearAllocator* chunk =
+        chunkCount ? &systemPtr->chunks[chunkCount - 1] : 0;
+
+    // linearAlloc aligns the offset to 16, so leave room for that
+    if (!chunk || chunk->allocated + size + 16 > chunk->totalSize) {
+        u64 chunkSize =
+            size > STRING_TABLE_CHUNK_SIZE ? size : STRING_TABLE_CHUNK_SIZE;
+        void* memory =
+            fmallocEx(chunkSize, MEMORY_TAG_STRING, FMALLOC_FLAG_NO_ZERO);
+        linearAllocator newChunk;
+        if (!memory || !linearAllocCreate(chunkSize, memory, &newChunk)) {
+            FERROR("Failed to allocate a chunk for the string table.");
+            ffree(memory);
+            return 0;
+        }
+        systemPtr->chunks = dinoPush_linearAllocator(systemPtr->chunks, newChunk);
+        chunk = &systemPtr->chunks[chunkCount];
+    }
+
+    char* copy = linearAlloc(chunk, size);
+    if (copy) {
+        fcpyMem(copy, str, length);
+        copy[length] = 0;
+    }
+    return copy;
+}
+
+stringId stringInternN(const char* str, u64 length) {
+    if (!systemPtr) {
+        FERROR("String table was called before it was inited.")
+        return STRING_ID_INVALID;
+    }
+    if (!str) {
+        FERROR("stringIntern called with a null string.");
+        return STRING_ID_INVALID;
+    }
+
+    u64 hash = hashmapHashString(str, length);
+    stringId* found =
+        hashmapGetStrHashed(&systemPtr->lookup, str, length, hash);
+    if (found) {
+        return *found;
+    }
+
+    u64 count = dinoLength(systemPtr->strings);
+    if (count >= STRING_ID_INVALID) {
+        FERROR("String table is out of ids.");
+        return STRING_ID_INVALID;
+    }
+
+    char* copy = storeString(str, length);
+    if (!copy) {
+        return STRING_ID_INVALID;
+    }
+
+    stringId id = (stringId)count;
+    // Keyed on the stored copy so the key lives as long as the entry
+    if (!hashmapInsertStrHashed(&systemPtr->lookup, copy, length, hash, &id)) {
+        FERROR("Failed to add '%s' to the string table.", copy);
+        return STRING_ID_INVALID;
+    }
+    internedString entry = {copy, hash, length};
+    systemPtr->strings = dinoPush_internedString(systemPtr->strings, entry);
+    return id;
+}
+
+stringId stringIntern(const char* str) {
+    if (!str) {
+        FERROR("stringIntern called with a null string.");
+        return STRING_ID_INVALID;
+    }
+    return stringInternN(str, strlen(str));
+}
+
+stringId stringFind(const char* str) {
+    if (!systemPtr || !str) {
+        return STRING_ID_INVALID;
+    }
+    u64 length = strlen(str);
+    stringId* found = hashmapGetStrHashed(&systemPtr->lookup, str, length,
+                                          hashmapHashString(str, length));
+    return found ? *found : STRING_ID_INVALID;
+}
+
+// Entry for `id` or 0 if it's not a valid id
+static internedString* getEntry(stringId id) {
+    if (!systemPtr || id >= dinoLength(systemPtr->strings)) {
+        return 0;
+    }
+    return &systemPtr->strings[id];
+}
+
+const char* stringGet(stringId id) {
+    internedString* entry = getEntry(id);
+    return entry ? entry->str : 0;
+}
+
+u64 stringGetLength(stringId id) {
+    internedString* entry = getEntry(id);
+    return entry ? entry->length : 0;
+}
+
+u64 stringGetHash(stringId id) {
+    internedString* entry = getEntry(id);
+    return entry ? entry->hash : 0;
+}
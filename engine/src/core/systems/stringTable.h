@@ -0,0 +1,64 @@
+#pragma once
+
+#include "defines.h"
+
+/*
+ * Interned strings. Every distinct string is stored once and given a 32 bit
+ * id, so identifiers (names of apps, events, assets, ...) can be compared and
+ * hashed as ints. The stored copies never move or get freed until shutdown, so
+ * the pointer from `stringGet` can be kept around.
+ */
+
+typedef u32 stringId;
+
+#define STRING_ID_INVALID INVALID_ID
+
+/**
+ * @brief Init the string table. Must be called twice once with no state (state
+ * = 0) to get the memoryRequirement. Another after the state has been assigned
+ * a memory block. (All systems work this way)
+ * @param memoryRequirement out Variable that will tell you how much memory is
+ * required for this system.
+ * @param state Pointer to the block of memory that was allocated outside.
+ */
+b8 stringTableInit(u64* memoryRequirement, void* state);
+
+/**
+ * @brief Shutsdown the string table. Every id/pointer it gave out is invalid
+ * after this.
+ */
+void stringTableShutdown();
+
+/**
+ * @brief Gets the id of `str`, storing a copy of it if it's new.
+ * @returns the id, STRING_ID_INVALID if failed
+ */
+CT_API stringId stringIntern(const char* str);
+
+/**
+ * @brief Same as `stringIntern` for the first `length` chars of `str`. Doesn't
+ * have to be null terminated.
+ */
+CT_API stringId stringInternN(const char* str, u64 length);
+
+/**
+ * @brief Gets the id of `str` without storing it.
+ * @returns the id, STRING_ID_INVALID if `str` was never interned
+ */
+CT_API stringId stringFind(const char* str);
+
+/**
+ * @returns the stored null terminated string, 0 if `id` isn't valid
+ */
+CT_API const char* stringGet(stringId id);
+
+/**
+ * @returns the length of the stored string, 0 if `id` isn't valid
+ */
+CT_API u64 stringGetLength(stringId id);
+
+/**
+ * @returns the string's `hashmapHashString` hash. It's computed once when the
+ * string is interned
+ */
+CT_API u64 stringGetHash(stringId id);
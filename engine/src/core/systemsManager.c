@@ -3,35 +3,69 @@
 #include "core/systems/fmemory.h"
 #include "core/systems/input.h"
 #include "core/systems/logger.h"
+#include "core/systems/stringTable.h"
 #include "platform/platform.h"
 #include "renderer/renderer.h"
 #include "renderer/renderInfo.h"
 
+// Room for the stack allocator to align each system's block
+#define SYSTEMS_BLOCK_PADDING 16
+
+// Marks the stack, then hands out the system's block from it
+static void* pushSystem(SystemsInfo* si, u64 memReq, stackMarker* outMarker) {
+    *outMarker = stackAllocGetMarker(&si->allocator);
+    return stackAlloc(&si->allocator, memReq);
+}
+
 b8 systemsInit(SystemsInfo* si) {
+    // Get every requirement first so all the systems fit in one block
     eventInit(&si->systemMemReqEvent, 0);
-    si->systemMemBlockEvent = fmalloc(si->systemMemReqEvent, MEMORY_TAG_SYSTEM);
+    loggerInit(&si->systemMemReqLogging, 0);
+    inputInit(&si->systemMemReqInput, 0);
+    stringTableInit(&si->systemMemReqStringTable, 0);
+    platformInit(&si->systemMemReqPlatform, 0);
+    rendererInit(&si->systemMemReqRenderer, 0, RENDERER_TYPE_VULKAN);
+
+    u64 totalSize = si->systemMemReqEvent + si->systemMemReqLogging +
+                    si->systemMemReqInput + si->systemMemReqStringTable +
+                    si->systemMemReqPlatform + si->systemMemReqRenderer +
+                    SYSTEMS_BLOCK_PADDING * 6;
+    si->allocatorBlock = fmalloc(totalSize, MEMORY_TAG_SYSTEM);
+    if (!si->allocatorBlock ||
+        !stackAllocCreate(totalSize, si->allocatorBlock, &si->allocator)) {
+        FFATAL("Failed to allocate memory for the systems.");
+        return false;
+    }
+
+    si->systemMemBlockEvent =
+        pushSystem(si, si->systemMemReqEvent, &si->systemMarkerEvent);
     eventInit(&si->systemMemReqEvent, si->systemMemBlockEvent);
 
-    loggerInit(&si->systemMemReqLogging, 0);
     si->systemMemBlockLogging =
-        fmalloc(si->systemMemReqLogging, MEMORY_TAG_SYSTEM);
+        pushSystem(si, si->systemMemReqLogging, &si->systemMarkerLogging);
     loggerInit(&si->systemMemReqLogging, si->systemMemBlockLogging);
 
-    inputInit(&si->systemMemReqInput, 0);
-    si->systemMemBlockInput = fmalloc(si->systemMemReqInput, MEMORY_TAG_SYSTEM);
+    si->systemMemBlockInput =
+        pushSystem(si, si->systemMemReqInput, &si->systemMarkerInput);
     inputInit(&si->systemMemReqInput, si->systemMemBlockInput);
 
+    si->systemMemBlockStringTable = pushSystem(
+        si, si->systemMemReqStringTable, &si->systemMarkerStringTable);
+    if (!stringTableInit(&si->systemMemReqStringTable,
+                         si->systemMemBlockStringTable)) {
+        FFATAL("Failed to init the string table.");
+        return false;
+    }
+
     // TODO: Register program events. (Resize, Buttons)
 
     FINFO("Starting platform")
-    platformInit(&si->systemMemReqPlatform, 0);
     si->systemMemBlockPlatform =
-        fmalloc(si->systemMemReqPlatform, MEMORY_TAG_SYSTEM);
+        pushSystem(si, si->systemMemReqPlatform, &si->systemMarkerPlatform);
     platformInit(&si->systemMemReqPlatform, si->systemMemBlockPlatform);
 
-    rendererInit(&si->systemMemReqRenderer, 0, RENDERER_TYPE_VULKAN);
     si->systemMemBlockRenderer =
-        fmalloc(si->systemMemReqRenderer, MEMORY_TAG_SYSTEM);
+        pushSystem(si, si->systemMemReqRenderer, &si->systemMarkerRenderer);
     rendererInit(&si->systemMemReqRenderer, si->systemMemBlockRenderer, RENDERER_TYPE_VULKAN);
 
     return true;
@@ -39,10 +73,25 @@ b8 systemsInit(SystemsInfo* si) {
 
 b8 systemsShutdown(SystemsInfo* si) {
     FINFO("Starting Engine Shutdown");
+#ifdef GE_EVENT_INSTRUMENTATION
+    // Before the string table goes so named events print their names
+    eventReport();
+#endif
     rendererShutdown(si->systemMemBlockRenderer);
+    stackAllocFreeToMarker(&si->allocator, si->systemMarkerRenderer);
     platformShutdown();
+    stackAllocFreeToMarker(&si->allocator, si->systemMarkerPlatform);
+    stringTableShutdown();
+    stackAllocFreeToMarker(&si->allocator, si->systemMarkerStringTable);
     inputShutdown(si->systemMemBlockInput);
+    stackAllocFreeToMarker(&si->allocator, si->systemMarkerInput);
     loggerShutdown();
+    stackAllocFreeToMarker(&si->allocator, si->systemMarkerLogging);
     eventShutdown();
+    stackAllocFreeToMarker(&si->allocator, si->systemMarkerEvent);
+
+    stackAllocDestroy(&si->allocator);
+    ffree(si->allocatorBlock);
+    si->allocatorBlock = 0;
     return true;
 }
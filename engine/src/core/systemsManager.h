@@ -1,22 +1,37 @@
 #pragma once
 
+#include "core/stackAllocator.h"
 #include "defines.h"
 
 typedef struct SystemsInfo {
+    // Every system's memory is carved from this in init order and freed back
+    // in reverse on shutdown
+    stackAllocator allocator;
+    void* allocatorBlock;
+
     u64 systemMemReqPlatform;
     void* systemMemBlockPlatform;
+    stackMarker systemMarkerPlatform;
 
     u64 systemMemReqEvent;
     void* systemMemBlockEvent;
+    stackMarker systemMarkerEvent;
 
     u64 systemMemReqLogging;
     void* systemMemBlockLogging;
+    stackMarker systemMarkerLogging;
 
     u64 systemMemReqInput;
     void* systemMemBlockInput;
+    stackMarker systemMarkerInput;
+
+    u64 systemMemReqStringTable;
+    void* systemMemBlockStringTable;
+    stackMarker systemMarkerStringTable;
 
     u64 systemMemReqRenderer;
     void* systemMemBlockRenderer;
+    stackMarker systemMarkerRenderer;
 } SystemsInfo;
 
 b8 systemsInit(SystemsInfo* si);
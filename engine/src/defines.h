@@ -89,6 +89,13 @@ STATIC_ASSERT(sizeof(f64) == 8, "Expected f64 to be 8 bytes.");
 #define GE_NOINLINE
 #endif
 
+// Thread local storage
+#ifdef _MSC_VER
+#define GE_THREAD_LOCAL __declspec(thread)
+#else
+#define GE_THREAD_LOCAL _Thread_local
+#endif
+
 // Platform detection
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__)
 #define GE_PLATFORM_WINDOWS 1
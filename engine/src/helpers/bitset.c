@@ -0,0 +1,151 @@
+#include "bitset.h"
+
+#include "core/systems/fmemory.h"
+#include "core/systems/logger.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BITSET_SSE2
+#endif
+
+u64 bitsCount(const u64* words, u64 wordCount) {
+    u64 count = 0;
+    for (u64 i = 0; i < wordCount; ++i) {
+        count += __builtin_popcountll(words[i]);
+    }
+    return count;
+}
+
+b8 bitsAny(const u64* words, u64 wordCount) {
+    return bitsFindFirstSet(words, wordCount, 0) != BITSET_NOT_FOUND;
+}
+
+// First word at or after `word` that isn't equal to `skip` (0 or ~0). Skips
+// 2 words per compare with SSE2
+static u64 findWordNot(const u64* words, u64 wordCount, u64 word, u64 skip) {
+#ifdef BITSET_SSE2
+    __m128i skipVec = _mm_set1_epi32((i32)skip);
+    for (; word + 2 <= wordCount; word += 2) {
+        __m128i pair = _mm_loadu_si128((const __m128i*)&words[word]);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(pair, skipVec)) != 0xFFFF) {
+            return words[word] != skip ? word : word + 1;
+        }
+    }
+#endif
+    for (; word < wordCount; ++word) {
+        if (words[word] != skip) {
+            return word;
+        }
+    }
+    return BITSET_NOT_FOUND;
+}
+
+u64 bitsFindFirstSet(const u64* words, u64 wordCount, u64 from) {
+    u64 word = from / BITSET_WORD_BITS;
+    if (word >= wordCount) {
+        return BITSET_NOT_FOUND;
+    }
+
+    // Part of the first word at or after `from`
+    u64 bits = words[word] & (~0ULL << (from % BITSET_WORD_BITS));
+    if (bits) {
+        return word * BITSET_WORD_BITS + __builtin_ctzll(bits);
+    }
+
+    word = findWordNot(words, wordCount, word + 1, 0);
+    if (word == BITSET_NOT_FOUND) {
+        return BITSET_NOT_FOUND;
+    }
+    return word * BITSET_WORD_BITS + __builtin_ctzll(words[word]);
+}
+
+u64 bitsFindFirstClear(const u64* words, u64 wordCount, u64 from) {
+    u64 word = from / BITSET_WORD_BITS;
+    if (word >= wordCount) {
+        return BITSET_NOT_FOUND;
+    }
+
+    u64 bits = ~words[word] & (~0ULL << (from % BITSET_WORD_BITS));
+    if (bits) {
+        return word * BITSET_WORD_BITS + __builtin_ctzll(bits);
+    }
+
+    word = findWordNot(words, wordCount, word + 1, ~0ULL);
+    if (word == BITSET_NOT_FOUND) {
+        return BITSET_NOT_FOUND;
+    }
+    return word * BITSET_WORD_BITS + __builtin_ctzll(~words[word]);
+}
+
+void bitsXor(u64* out, const u64* a, const u64* b, u64 wordCount) {
+    for (u64 i = 0; i < wordCount; ++i) {
+        out[i] = a[i] ^ b[i];
+    }
+}
+
+b8 bitsetCreate(u64 bitCount, bitset* outSet) {
+    if (!outSet) {
+        FERROR("bitsetCreate needs a set.");
+        return false;
+    }
+    outSet->words = 0;
+    outSet->bitCount = 0;
+    return bitsetResize(outSet, bitCount);
+}
+
+void bitsetDestroy(bitset* set) {
+    if (!set) {
+        return;
+    }
+    ffree(set->words);
+    set->words = 0;
+    set->bitCount = 0;
+}
+
+b8 bitsetResize(bitset* set, u64 bitCount) {
+    u64 oldWords = BITSET_WORDS(set->bitCount);
+    u64 newWords = BITSET_WORDS(bitCount);
+    if (newWords != oldWords) {
+        u64* words = 0;
+        if (newWords) {
+            // fmalloc zeroes it, so only the kept words need copying
+            words = fmalloc(newWords * sizeof(u64), MEMORY_TAG_ARRAY);
+            if (!words) {
+                FERROR("Failed to allocate a bitset of %llu bits.", bitCount);
+                return false;
+            }
+            if (set->words) {
+                fcpyMem(words, set->words,
+                        (oldWords < newWords ? oldWords : newWords) *
+                            sizeof(u64));
+            }
+        }
+        ffree(set->words);
+        set->words = words;
+    }
+
+    // Bits dropped from the last word have to read as clear if it grows again
+    if (bitCount < set->bitCount && bitCount % BITSET_WORD_BITS) {
+        set->words[newWords - 1] &= ~(~0ULL << (bitCount % BITSET_WORD_BITS));
+    }
+    set->bitCount = bitCount;
+    return true;
+}
+
+void bitsetClearAll(bitset* set) {
+    fzeroMemory(set->words, BITSET_WORDS(set->bitCount) * sizeof(u64));
+}
+
+u64 bitsetCount(const bitset* set) {
+    return bitsCount(set->words, BITSET_WORDS(set->bitCount));
+}
+
+u64 bitsetFindFirstSet(const bitset* set, u64 from) {
+    return bitsFindFirstSet(set->words, BITSET_WORDS(set->bitCount), from);
+}
+
+u64 bitsetFindFirstClear(const bitset* set, u64 from) {
+    u64 bit =
+        bitsFindFirstClear(set->words, BITSET_WORDS(set->bitCount), from);
+    return bit < set->bitCount ? bit : BITSET_NOT_FOUND;
+}
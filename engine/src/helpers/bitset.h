@@ -0,0 +1,90 @@
+#pragma once
+
+#include "defines.h"
+
+/*
+ * Bit arrays stored as u64 words. The `bits...` FNs work on any word array, so
+ * a fixed set can live inside a struct (`u64 keys[BITSET_WORDS(256)]`). The
+ * `bitset` struct is the growable version that owns its words.
+ *
+ * Whole-array operations (count, find, any) go a word (or 2 with SSE2) at a
+ * time, so scanning 256 bits is 4 word tests instead of 256 byte reads.
+ */
+
+#define BITSET_WORD_BITS 64
+// Words needed to hold `bits` bits
+#define BITSET_WORDS(bits) (((bits) + BITSET_WORD_BITS - 1) / BITSET_WORD_BITS)
+// Returned by the find FNs when no bit matches
+#define BITSET_NOT_FOUND 0xFFFFFFFFFFFFFFFFULL
+
+static inline void bitsSet(u64* words, u64 bit) {
+    words[bit / BITSET_WORD_BITS] |= 1ULL << (bit % BITSET_WORD_BITS);
+}
+
+static inline void bitsClear(u64* words, u64 bit) {
+    words[bit / BITSET_WORD_BITS] &= ~(1ULL << (bit % BITSET_WORD_BITS));
+}
+
+static inline void bitsPut(u64* words, u64 bit, b8 value) {
+    if (value) {
+        bitsSet(words, bit);
+    } else {
+        bitsClear(words, bit);
+    }
+}
+
+static inline b8 bitsTest(const u64* words, u64 bit) {
+    return (words[bit / BITSET_WORD_BITS] >> (bit % BITSET_WORD_BITS)) & 1;
+}
+
+// Number of set bits in the first `wordCount` words
+CT_API u64 bitsCount(const u64* words, u64 wordCount);
+
+// True if any bit is set
+CT_API b8 bitsAny(const u64* words, u64 wordCount);
+
+/**
+ * @brief Finds the first set bit at or after `from`.
+ * @returns the bit index, BITSET_NOT_FOUND if there isn't one
+ */
+CT_API u64 bitsFindFirstSet(const u64* words, u64 wordCount, u64 from);
+
+/**
+ * @brief Finds the first clear bit at or after `from`. The unused bits at the
+ * end of the last word are checked too, so check the result against your bit
+ * count.
+ * @returns the bit index, BITSET_NOT_FOUND if there isn't one
+ */
+CT_API u64 bitsFindFirstClear(const u64* words, u64 wordCount, u64 from);
+
+// out = a ^ b. `out` can be `a` or `b`
+CT_API void bitsXor(u64* out, const u64* a, const u64* b, u64 wordCount);
+
+typedef struct bitset {
+    u64* words;
+    u64 bitCount;
+} bitset;
+
+/**
+ * @brief Creates a bitset with every bit clear. Memory comes from the memory
+ * system.
+ * @returns true if successful, false if failed
+ */
+CT_API b8 bitsetCreate(u64 bitCount, bitset* outSet);
+
+CT_API void bitsetDestroy(bitset* set);
+
+/**
+ * @brief Grows or shrinks the set. Kept bits keep their value, new ones are
+ * clear.
+ * @returns true if successful, false if failed
+ */
+CT_API b8 bitsetResize(bitset* set, u64 bitCount);
+
+// Clears every bit
+CT_API void bitsetClearAll(bitset* set);
+
+// Wrappers over the `bits...` FNs for a whole set
+CT_API u64 bitsetCount(const bitset* set);
+CT_API u64 bitsetFindFirstSet(const bitset* set, u64 from);
+CT_API u64 bitsetFindFirstClear(const bitset* set, u64 from);
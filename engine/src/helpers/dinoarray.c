@@ -8,8 +8,18 @@
 #define DINO_MALLOC(size) fmalloc(size, MEMORY_TAG_DINO)
 #endif
 
+// For blocks that are about to be written over anyway
+#ifndef DINO_MALLOC_UNZEROED
+#define DINO_MALLOC_UNZEROED(size)                                             \
+    fmallocEx(size, MEMORY_TAG_DINO, FMALLOC_FLAG_NO_ZERO)
+#endif
+
+#ifndef DINO_REALLOC
+#define DINO_REALLOC(block, size) frealloc(block, size)
+#endif
+
 #ifndef DINO_FREE
-#define DINO_FREE(block, size) ffree(block, size, MEMORY_TAG_DINO)
+#define DINO_FREE(block) ffree(block)
 #endif
 
 void* _dino_create(unsigned long long length, unsigned long long stride,
@@ -19,7 +29,9 @@ void* _dino_create(unsigned long long length, unsigned long long stride,
     unsigned long long header =
         DINOARRAY_FIELD_LENGTH * sizeof(unsigned long long);
     unsigned long long mix = (length * stride) + header;
-    void* newArr = DINO_MALLOC(mix);
+    // Elements past the length are never read. Only zero them when the length
+    // covers them.
+    void* newArr = setLength ? DINO_MALLOC(mix) : DINO_MALLOC_UNZEROED(mix);
     // Set header info
     ((unsigned long long*)newArr)[DINOARRAY_MAX_SIZE] = length;
     ((unsigned long long*)newArr)[DINOARRAY_LENGTH] = (setLength) ? length : 0;
@@ -31,30 +43,52 @@ void* _dino_create(unsigned long long length, unsigned long long stride,
 void _dino_destroy(void* array) {
     unsigned long long* header =
         (unsigned long long*)array - DINOARRAY_FIELD_LENGTH;
-    DINO_FREE(header,
-              (dinoLength(array) * dinoStride(array)) +
-                  (sizeof(unsigned long long) * DINOARRAY_FIELD_LENGTH));
+    // The memory system remembers the size. So the whole capacity is freed
+    DINO_FREE(header);
+}
+
+// Reallocates the array to hold `maxSize` elements. Only moves (and copies)
+// the array if it can't be resized in place. On failure the array is returned
+// unchanged, callers check dinoMaxSize before writing.
+static void* _dino_set_max_size(void* array, unsigned long long maxSize) {
+    unsigned long long* header =
+        (unsigned long long*)array - DINOARRAY_FIELD_LENGTH;
+    unsigned long long headerSize =
+        DINOARRAY_FIELD_LENGTH * sizeof(unsigned long long);
+    unsigned long long* newHeader = DINO_REALLOC(
+        header, (maxSize * header[DINOARRAY_STRIDE]) + headerSize);
+    if (!newHeader) {
+        fprintf(stderr, "DINO ERROR: Failed to resize array to %llu elements",
+                maxSize);
+        return array;
+    }
+    header = newHeader;
+    header[DINOARRAY_MAX_SIZE] = maxSize;
+    return ((void*)(header + DINOARRAY_FIELD_LENGTH));
 }
 
 void* _dino_resize(void* array) {
-    unsigned long long length = dinoLength(array);
-    unsigned long long stride = dinoStride(array);
-    void* temp = _dino_create(dinoMaxSize(array) * DINO_DEFAULT_RESIZE_FACTOR,
-                              stride, false);
-    memcpy(temp, array, length * stride);
-    _dino_destroy(array);
-    dinoLengthSet(temp, length);
-    return temp;
+    return _dino_set_max_size(array,
+                              dinoMaxSize(array) * DINO_DEFAULT_RESIZE_FACTOR);
+}
+
+// Grows the array so it can hold `needed` elements. At least doubles it so
+// pushing one at a time stays amortized O(1).
+static void* _dino_grow_to(void* array, unsigned long long needed) {
+    unsigned long long maxSize = dinoMaxSize(array);
+    if (needed <= maxSize) {
+        return array;
+    }
+    maxSize *= DINO_DEFAULT_RESIZE_FACTOR;
+    return _dino_set_max_size(array, needed > maxSize ? needed : maxSize);
+}
+
+void* _dino_reserve(void* array, unsigned long long maxSize) {
+    return _dino_grow_to(array, maxSize);
 }
 
 void* _dino_shrink(void* array) {
-    unsigned long long length = dinoLength(array);
-    unsigned long long stride = dinoStride(array);
-    void* temp = _dino_create(length + 1, stride, false);
-    memcpy(temp, array, length * stride);
-    _dino_destroy(array);
-    dinoLengthSet(temp, length);
-    return temp;
+    return _dino_set_max_size(array, dinoLength(array) + 1);
 }
 
 unsigned long long _dino_field_get(void* array, unsigned long long field) {
@@ -74,9 +108,9 @@ void* _dino_push(void* array, const void* valuePtr) {
     unsigned long long length = dinoLength(array);
     unsigned long long stride = dinoStride(array);
     // printf("Length: %llu, MaxSize: %llu\n", length, dinoMaxSize(array));
-    if (length >= dinoMaxSize(array)) {
-        // printf("Resizing Array\n");
-        array = _dino_resize(array);
+    array = _dino_grow_to(array, length + 1);
+    if (dinoMaxSize(array) < length + 1) {
+        return array;
     }
     unsigned long long idx = (unsigned long long)array;
     // Since length is One-based and array is Zero-based we don't have to add
@@ -87,6 +121,29 @@ void* _dino_push(void* array, const void* valuePtr) {
     return array;
 }
 
+void* _dino_push_n(void* array, const void* values, unsigned long long count) {
+    if (count == 0) {
+        return array;
+    }
+    unsigned long long length = dinoLength(array);
+    unsigned long long stride = dinoStride(array);
+    array = _dino_grow_to(array, length + count);
+    if (dinoMaxSize(array) < length + count) {
+        return array;
+    }
+    memcpy((char*)array + (length * stride), values, count * stride);
+    dinoLengthSet(array, length + count);
+    return array;
+}
+
+void* _dino_append(void* array, void* other) {
+    if (dinoStride(array) != dinoStride(other)) {
+        fprintf(stderr, "DINO ERROR: Appending an array with another stride");
+        return array;
+    }
+    return _dino_push_n(array, other, dinoLength(other));
+}
+
 void* _dino_insert_at(void* array, unsigned long long idx, void* valuePtr) {
     unsigned long long length = dinoLength(array);
     unsigned long long stride = dinoStride(array);
@@ -94,18 +151,18 @@ void* _dino_insert_at(void* array, unsigned long long idx, void* valuePtr) {
         fprintf(stderr, "DINO ERROR: Index was more than array length");
         return array;
     }
-    if (length >= dinoMaxSize(array)) {
-        array = _dino_resize(array);
+    array = _dino_grow_to(array, length + 1);
+    if (dinoMaxSize(array) < length + 1) {
+        return array;
     }
     unsigned long long memIdx = (unsigned long long)array;
 
-    // If idx isn't at the end move elements after it down one
-    // Element after the index to move the afterbit to
+    // Move the elements from idx on down one. idx < length so there's always
+    // at least one
     unsigned long long elementAfter = memIdx + ((idx + 1) * stride);
     unsigned long long afterbit = memIdx + (idx * stride);
-    if (idx != length - 1) {
-        memcpy((void*)elementAfter, (void*)afterbit, stride * (length - idx));
-    }
+    // The ranges overlap
+    memmove((void*)elementAfter, (void*)afterbit, stride * (length - idx));
     // Actually copy the idx value into the array
     memcpy((void*)(memIdx + (idx * stride)), valuePtr, stride);
     dinoLengthSet(array, length + 1);
@@ -138,7 +195,9 @@ void* _dino_pop_at(void* array, unsigned long long idx, void* dest) {
     unsigned long long elementAfter = memIdx + ((idx + 1) * stride);
     unsigned long long afterbit = memIdx + (idx * stride);
     if (idx != length - 1) {
-        memcpy((void*)afterbit, (void*)elementAfter, stride * (length - idx));
+        // The ranges overlap. Only the elements after `idx` move
+        memmove((void*)afterbit, (void*)elementAfter,
+                stride * (length - idx - 1));
     }
     dinoLengthSet(array, length - 1);
     return array;
@@ -33,6 +33,7 @@ enum {
 void* _dino_create(unsigned long long length, unsigned long long stride, _Bool setLength);
 void _dino_destroy(void* array);
 void* _dino_resize(void* array);
+void* _dino_reserve(void* array, unsigned long long maxSize);
 void* _dino_shrink(void* array);
 
 unsigned long long _dino_field_get(void* array, unsigned long long field);
@@ -40,6 +41,8 @@ void _dino_field_set(void* array, unsigned long long field,
                      unsigned long long value);
 
 void* _dino_push(void* array, const void* valuePtr);
+void* _dino_push_n(void* array, const void* values, unsigned long long count);
+void* _dino_append(void* array, void* other);
 void _dino_pop(void* array, void* dest);
 
 void* _dino_pop_at(void* array, unsigned long long idx, void* dest);
@@ -78,6 +81,13 @@ void* _dino_insert_at(void* array, unsigned long long idx, void* valuePtr);
  */
 #define dinoDestroy(array) _dino_destroy(array);
 
+/**
+ *  Makes sure the Dino array can hold at least `maxSize` elements without
+ * resizing. Grows geometrically so reserving a little more each time is still
+ * cheap. Never shrinks.
+ */
+#define dinoReserve(array, maxSize) array = _dino_reserve(array, maxSize)
+
 /**
  *  Shrinks the Dino array to it's length so no memory is being wasted.
  *  This does perform a reallocate.
@@ -93,6 +103,19 @@ void* _dino_insert_at(void* array, unsigned long long idx, void* valuePtr);
         array = _dino_push(array, &t);                                         \
     }
 
+/**
+ *  Push `count` elements from `valuesPtr` to the Dino array. Resizes at most
+ * once and copies them all in one go.
+ */
+#define dinoPushN(array, valuesPtr, count)                                     \
+    array = _dino_push_n(array, valuesPtr, count)
+
+/**
+ *  Push every element of the Dino array `other` to `array`. Both need the same
+ * stride.
+ */
+#define dinoAppendArray(array, other) array = _dino_append(array, other)
+
 /**
  *  Pop the last element value from the Dino array.
  */
@@ -131,18 +154,57 @@ void* _dino_insert_at(void* array, unsigned long long idx, void* valuePtr);
 
 //====================== QOL Variables Defined ======================
 
+/**
+ *  The header fields sit right in front of the first element. Reading them
+ * straight from there saves a function call per read in hot loops.
+ */
+#define _DINO_HEADER(array)                                                    \
+    ((unsigned long long*)(array) - DINOARRAY_FIELD_LENGTH)
+
 /**
  *  Get the Max Size / Capacity of the Dino Array
  */
-#define dinoMaxSize(array) _dino_field_get(array, DINOARRAY_MAX_SIZE)
+#define dinoMaxSize(array) (_DINO_HEADER(array)[DINOARRAY_MAX_SIZE])
 
 /**
  *  Get the Length of the Dino Array
  */
-#define dinoLength(array) _dino_field_get(array, DINOARRAY_LENGTH)
+#define dinoLength(array) (_DINO_HEADER(array)[DINOARRAY_LENGTH])
 
 /**
  *  Get the Stride of the Dino Array
  */
-#define dinoStride(array) _dino_field_get(array, DINOARRAY_STRIDE)
+#define dinoStride(array) (_DINO_HEADER(array)[DINOARRAY_STRIDE])
+
+//====================== Typed Functions ======================
+
+/**
+ *  Generates typed, inline-able versions of the common calls for `T`. The
+ * stride is known at compile time so there is no memcpy and no function call
+ * unless the array has to grow. `T` has to be a single identifier, typedef
+ * pointers/structs first. Put it in the .c file that uses them.
+ *
+ *  T* dinoPush_T(T* array, T value)   returns the (maybe moved) array
+ *  T dinoPop_T(T* array)              removes and returns the last element
+ *  T dinoGet_T(T* array, idx)         returns the element at `idx`
+ */
+#define DINO_DEFINE(T)                                                         \
+    static inline T* dinoPush_##T(T* array, T value) {                         \
+        unsigned long long length = dinoLength(array);                         \
+        if (length >= dinoMaxSize(array)) {                                    \
+            array = (T*)_dino_reserve(array, length + 1);                      \
+            if (dinoMaxSize(array) <= length) {                                \
+                return array;                                                  \
+            }                                                                  \
+        }                                                                      \
+        array[length] = value;                                                 \
+        dinoLength(array) = length + 1;                                        \
+        return array;                                                          \
+    }                                                                          \
+    static inline T dinoPop_##T(T* array) {                                    \
+        return array[--dinoLength(array)];                                     \
+    }                                                                          \
+    static inline T dinoGet_##T(T* array, unsigned long long idx) {            \
+        return array[idx];                                                     \
+    }
 
@@ -11,23 +11,135 @@
 typedef struct freelistNode {
     u64 offset;
     u64 size;
+    // Neighbours in offset order
     struct freelistNode* next;
+    struct freelistNode* prev;
+    // Neighbours in the node's size bin
+    struct freelistNode* sizeNext;
+    struct freelistNode* sizePrev;
 } freelistNode;
 
+// One size bin per power of two. Bin N holds nodes with sizes in
+// [2^N, 2^(N+1))
+#define FREELIST_SIZE_BIN_COUNT 64
+
 typedef struct internalState {
     u64 totalSize;
     u64 maxEntries;
     freelistNode* head;
     freelistNode* nodes;
+    // Intrusive stack of nodes that were used then given back. Linked through
+    // `next`.
+    freelistNode* unusedNodes;
+    // Nodes past this index have never been handed out. Lets us skip touching
+    // (and zeroing) the whole node array up front.
+    u64 nextFreshNode;
+    // Free nodes by size so allocations don't have to walk the list
+    freelistNode* sizeBins[FREELIST_SIZE_BIN_COUNT];
+    // Bit N is set when sizeBins[N] has at least one node in it
+    u64 sizeMask;
 } internalState;
 
+// How many bytes of the managed block each node is reserved for. A node is
+// only needed per free range and free ranges are always split by an
+// allocation. So this covers a block chopped into alternating 32 byte
+// used/free pieces, which the dynaAllocator's 16 byte classes make rare.
+#define FREELIST_BYTES_PER_NODE 64
+
+static u64 getMaxEntries(u64 totalSize) {
+    u64 maxEntries = totalSize / FREELIST_BYTES_PER_NODE;
+    // Small lists still need enough nodes to be usable
+    return maxEntries < 16 ? 16 : maxEntries;
+}
+
 freelistNode* getNode(freelist* list);
 void invalidateNode(freelist* list, freelistNode* node);
+static void resetNodes(internalState* state);
+
+static u32 getSizeBin(u64 size) { return 63 - __builtin_clzll(size); }
+
+static void linkSize(internalState* state, freelistNode* node) {
+    u32 bin = getSizeBin(node->size);
+    node->sizePrev = 0;
+    node->sizeNext = state->sizeBins[bin];
+    if (node->sizeNext) {
+        node->sizeNext->sizePrev = node;
+    }
+    state->sizeBins[bin] = node;
+    state->sizeMask |= 1ULL << bin;
+}
+
+static void unlinkSize(internalState* state, freelistNode* node) {
+    u32 bin = getSizeBin(node->size);
+    if (node->sizePrev) {
+        node->sizePrev->sizeNext = node->sizeNext;
+    } else {
+        state->sizeBins[bin] = node->sizeNext;
+        if (!node->sizeNext) {
+            state->sizeMask &= ~(1ULL << bin);
+        }
+    }
+    if (node->sizeNext) {
+        node->sizeNext->sizePrev = node->sizePrev;
+    }
+}
+
+// Moves the node to the bin of its new size
+static void setNodeSize(internalState* state, freelistNode* node, u64 size) {
+    if (getSizeBin(size) == getSizeBin(node->size)) {
+        node->size = size;
+        return;
+    }
+    unlinkSize(state, node);
+    node->size = size;
+    linkSize(state, node);
+}
+
+// Puts a new node in offset order after `previous` (at the head if 0) and
+// into its size bin
+static void insertNode(internalState* state, freelistNode* previous,
+                       freelistNode* node) {
+    node->prev = previous;
+    node->next = previous ? previous->next : state->head;
+    if (node->next) {
+        node->next->prev = node;
+    }
+    if (previous) {
+        previous->next = node;
+    } else {
+        state->head = node;
+    }
+    linkSize(state, node);
+}
+
+static void removeNode(freelist* list, freelistNode* node) {
+    internalState* state = list->memory;
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        state->head = node->next;
+    }
+    if (node->next) {
+        node->next->prev = node->prev;
+    }
+    unlinkSize(state, node);
+    invalidateNode(list, node);
+}
+
+// Makes the whole range [0, totalSize) one free node
+static void resetToOneNode(internalState* state) {
+    resetNodes(state);
+    state->head = 0;
+    freelistNode* node = &state->nodes[0];
+    node->offset = 0;
+    node->size = state->totalSize;
+    insertNode(state, 0, node);
+}
 
 void freelistCreate(u64 totalSize, u64* memoryRequirement, void* memory,
                     freelist* outList) {
     // Find the max entries this freelist can have to est. the memReq
-    u64 maxEntries = (totalSize / sizeof(void*));
+    u64 maxEntries = getMaxEntries(totalSize);
 
     *memoryRequirement =
         sizeof(internalState) + (sizeof(freelistNode) * maxEntries);
@@ -39,66 +151,132 @@ void freelistCreate(u64 totalSize, u64* memoryRequirement, void* memory,
     outList->memory = memory;
     outList->memorySize = *memoryRequirement;
 
-    fzeroMemory(outList->memory, *memoryRequirement);
+    // Only the state needs to be zeroed. Nodes get set as they are handed out.
+    fzeroMemory(outList->memory, sizeof(internalState));
 
     internalState* state = outList->memory;
     state->nodes = (void*)(outList->memory + sizeof(internalState));
     state->maxEntries = maxEntries;
     state->totalSize = totalSize;
 
-    state->head = &state->nodes[0];
-    state->head->offset = 0;
-    state->head->size = totalSize;
-    state->head->next = 0;
+    resetToOneNode(state);
+}
+
+b8 freelistAllocateBlock(freelist* list, u64 size, u64* outOffset) {
+    return freelistAllocateBlockAligned(list, size, 1, outOffset);
+}
+
+static b8 nodeFits(freelistNode* node, u64 size, u64 alignment) {
+    u64 aligned = (node->offset + alignment - 1) & ~(alignment - 1);
+    return node->size >= (aligned - node->offset) + size;
+}
+
+b8 freelistAllocateBlockAligned(freelist* list, u64 size, u64 alignment,
+                                u64* outOffset) {
+    if (!list || !outOffset || !list->memory || !size) {
+        return false;
+    }
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        FERROR("freelistAllocateBlockAligned: alignment must be a power of 2.");
+        return false;
+    }
+    internalState* state = list->memory;
 
-    // Invalidate the nodes. This is how we will find an available one when we
-    // need it.
-    for (u64 i = 1; i < state->maxEntries; ++i) {
-        state->nodes[i].offset = INVALID_ID;
-        state->nodes[i].size = INVALID_ID;
+    // Any node in a bin at or past the one `worstCase` rounds up to is big
+    // enough wherever it starts. So the first non-empty one is a good fit
+    // without looking at a single node.
+    u64 worstCase = size + alignment - 1;
+    u32 fitBin = worstCase > 1 ? 64 - __builtin_clzll(worstCase - 1) : 0;
+    freelistNode* node = 0;
+    if (fitBin < FREELIST_SIZE_BIN_COUNT) {
+        u64 mask = state->sizeMask & (~0ULL << fitBin);
+        if (mask) {
+            node = state->sizeBins[__builtin_ctzll(mask)];
+        }
+    }
+    // Nothing is sure to fit. The bins below can still have a node that's
+    // big enough, it just has to be checked. Only happens when the list is
+    // close to full.
+    for (u32 bin = getSizeBin(size); !node && bin < fitBin; ++bin) {
+        for (freelistNode* n = state->sizeBins[bin]; n; n = n->sizeNext) {
+            if (nodeFits(n, size, alignment)) {
+                node = n;
+                break;
+            }
+        }
     }
+
+    if (!node) {
+        u64 freeSpace = freelistFreeSpace(list);
+        FDEBUG("freelistFindBlock, no block large enough found (requested: "
+               "%lluB, available: %lluB).",
+               size, freeSpace);
+        return false;
+    }
+
+    u64 aligned = (node->offset + alignment - 1) & ~(alignment - 1);
+    u64 padding = aligned - node->offset;
+    u64 remaining = node->size - padding - size;
+    if (padding > 0) {
+        // The space in front of the aligned offset stays free in `node`.
+        // Anything left after the block needs it's own node.
+        if (remaining > 0) {
+            freelistNode* tail = getNode(list);
+            if (!tail) {
+                return false;
+            }
+            tail->offset = aligned + size;
+            tail->size = remaining;
+            insertNode(state, node, tail);
+        }
+        setNodeSize(state, node, padding);
+    } else if (remaining > 0) {
+        // Node is larger. Deduct the memory from it and move the offset by
+        // that amount.
+        node->offset += size;
+        setNodeSize(state, node, remaining);
+    } else {
+        // Exact match. Just return the node.
+        removeNode(list, node);
+    }
+    *outOffset = aligned;
+    return true;
 }
 
-b8 freelistAllocateBlock(freelist* list, u64 size, u64* outOffset) {
-    if (!list || !outOffset || !list->memory) {
+b8 freelistAllocateBlockAt(freelist* list, u64 size, u64 offset) {
+    if (!list || !list->memory || !size) {
         return false;
     }
     internalState* state = list->memory;
     freelistNode* node = state->head;
-    freelistNode* previous = 0;
-    while (node) {
-        if (node->size == size) {
-            // Exact match. Just return the node.
-            *outOffset = node->offset;
-            freelistNode* nodeToReturn = 0;
-            if (previous) {
-                previous->next = node->next;
-                nodeToReturn = node;
+    // The list is sorted so stop once we are past the range
+    while (node && node->offset <= offset) {
+        u64 nodeEnd = node->offset + node->size;
+        if (nodeEnd >= offset + size) {
+            u64 front = offset - node->offset;
+            u64 back = nodeEnd - (offset + size);
+            if (front == 0 && back == 0) {
+                removeNode(list, node);
+            } else if (front == 0) {
+                node->offset += size;
+                setNodeSize(state, node, node->size - size);
+            } else if (back == 0) {
+                setNodeSize(state, node, node->size - size);
             } else {
-                // This node is the head of the list. Reassign the head
-                // and return the previous head node.
-                nodeToReturn = state->head;
-                state->head = node->next;
+                // Range is in the middle of the node. Split it in two.
+                freelistNode* tail = getNode(list);
+                if (!tail) {
+                    return false;
+                }
+                tail->offset = offset + size;
+                tail->size = back;
+                insertNode(state, node, tail);
+                setNodeSize(state, node, front);
             }
-            invalidateNode(list, nodeToReturn);
-            return true;
-        } else if (node->size > size) {
-            // Node is larger. Deduct the memory from it and move the offset
-            // by that amount.
-            *outOffset = node->offset;
-            node->size -= size;
-            node->offset += size;
             return true;
         }
-
-        previous = node;
         node = node->next;
     }
-
-    u64 freeSpace = freelistFreeSpace(list);
-    FWARN("freelistFindBlock, no block large enough found (requested: %lluB, "
-          "available: %lluB).",
-          size, freeSpace);
     return false;
 }
 
@@ -109,78 +287,54 @@ b8 freelistFreeBlock(freelist* list, u64 size, u64 offset) {
     internalState* state = list->memory;
     freelistNode* n = state->head;
     freelistNode* previous = 0;
-    if (!n) {
-        // If the whole thing is filled then we need another node at the start
-        freelistNode* nn = getNode(list);
-        nn->next = 0;
-        nn->size = size;
-        nn->offset = offset;
-        state->head = nn;
-        return true;
-    } else {
-        while (n) {
-            if (n->offset == offset) {
-                n->size += size;
-
-                // If two nodes get connected then we can connect them and
-                // delete one
-                if (n->next && n->next->offset == n->offset + n->size) {
-                    n->size += n->next->size;
-                    freelistNode* next = n->next;
-                    n->next = n->next->next;
-                    invalidateNode(list, next);
-                }
-                return true;
-            } else if (n->offset > offset) {
-                freelistNode* newNode = getNode(list);
-                newNode->offset = offset;
-                newNode->size = size;
-
-                // If their is a previous node update it's next var
-                if (previous) {
-                    previous->next = newNode;
-                    newNode->next = n;
-                } else {
-                    newNode->next = n;
-                    state->head = newNode;
-                }
-
-                // See if `newNode` can be connected to `n`
-                if (newNode->next &&
-                    newNode->offset + newNode->size == newNode->next->offset) {
-                    newNode->size += newNode->next->size;
-                    freelistNode* deletedNode = newNode->next;
-                    newNode->next = deletedNode->next;
-                    invalidateNode(list, deletedNode);
-                }
-
-                // See if `newNode` can be connected to `previous`
-                if (previous &&
-                    previous->offset + previous->size == newNode->offset) {
-                    previous->size += newNode->size;
-                    freelistNode* deletedNode = newNode;
-                    previous->next = deletedNode->next;
-                    invalidateNode(list, deletedNode);
-                }
-
-                return true;
-            }
+    // Find the first node past the block. Its neighbours are the only ones
+    // the block can merge with.
+    while (n && n->offset <= offset) {
+        previous = n;
+        n = n->next;
+    }
+    if ((previous && previous->offset + previous->size > offset) ||
+        (n && n->offset < offset + size)) {
+        // Part of the block is already free. Merging it would hand the same
+        // bytes out twice.
+        FERROR("freelistFreeBlock: range (offset: %llu, size: %llu) is "
+               "already free. Double free?",
+               offset, size);
+        return false;
+    }
 
-            previous = n;
-            n = n->next;
+    // See if the block can just be tacked onto `n` or `previous` before
+    // grabbing a new node.
+    b8 joinsPrevious = previous && previous->offset + previous->size == offset;
+    b8 joinsNext = n && offset + size == n->offset;
+    if (joinsPrevious) {
+        u64 merged = previous->size + size;
+        if (joinsNext) {
+            merged += n->size;
+            removeNode(list, n);
         }
+        setNodeSize(state, previous, merged);
+        return true;
+    } else if (joinsNext) {
+        n->offset = offset;
+        setNodeSize(state, n, n->size + size);
+        return true;
     }
 
-    FWARN("Unable to find block to be freed. Function could be written wrong "
-          "or the dev "
-          "who called this function is stupid, who knows what is true.");
-    return false;
+    freelistNode* newNode = getNode(list);
+    if (!newNode) {
+        return false;
+    }
+    newNode->offset = offset;
+    newNode->size = size;
+    insertNode(state, previous, newNode);
+    return true;
 }
 
 b8 freelistResize(freelist* list, u64* memoryReq, u64 size, void* newMemory,
-                  void* outOldMemory) {
+                  void** outOldMemory) {
     // Find the max entries this freelist can have to est. the memReq
-    u64 maxEntries = (size / sizeof(void*));
+    u64 maxEntries = getMaxEntries(size);
 
     *memoryReq = sizeof(internalState) + (sizeof(freelistNode) * maxEntries);
 
@@ -188,60 +342,51 @@ b8 freelistResize(freelist* list, u64* memoryReq, u64 size, void* newMemory,
         return true;
     }
 
-    outOldMemory = list->memory;
     internalState* oldState = (internalState*)list->memory;
+    if (size < oldState->totalSize) {
+        FWARN("freelistResize can only grow a freelist.");
+        return false;
+    }
     u64 sizeDiff = size - oldState->totalSize;
+    if (outOldMemory) {
+        *outOldMemory = list->memory;
+    }
     list->memory = newMemory;
+    list->memorySize = *memoryReq;
 
-    // The block's layout is head* first, then array of available nodes.
-    fzeroMemory(list->memory, *memoryReq);
+    // The block's layout is the state first, then array of available nodes.
+    fzeroMemory(list->memory, sizeof(internalState));
 
     // Setup the new state.
     internalState* state = (internalState*)list->memory;
     state->nodes = (void*)(list->memory + sizeof(internalState));
     state->maxEntries = maxEntries;
     state->totalSize = size;
+    resetNodes(state);
+    state->head = 0;
 
-    // Invalidate the nodes. This is how we will find an available one when we
-    // need it.
-    for (u64 i = 1; i < state->maxEntries; ++i) {
-        state->nodes[i].offset = INVALID_ID;
-        state->nodes[i].size = INVALID_ID;
+    // Copy over the nodes. Rebuilds the size bins as it goes
+    freelistNode* tail = 0;
+    freelistNode* nodeIter = oldState->head;
+    while (nodeIter) {
+        freelistNode* newNode = getNode(list);
+        newNode->size = nodeIter->size;
+        newNode->offset = nodeIter->offset;
+        insertNode(state, tail, newNode);
+        tail = newNode;
+        nodeIter = nodeIter->next;
     }
 
-    state->head = &state->nodes[0];
-
-    // Copy over the nodes.
-    freelistNode* newListNode = state->head;
-    freelistNode* nodeIter = oldState->head;
-    if (!nodeIter) {
-        state->head->offset = oldState->totalSize;
-        state->head->size = sizeDiff;
-        state->head->next = 0;
-    } else {
-        while (nodeIter) {
-            freelistNode* newNode = getNode(list);
-            newNode->next = 0;
-            newNode->size = nodeIter->size;
-            newNode->offset = nodeIter->offset;
-            newListNode->next = newNode;
-            // Move to the next entry.
-            newListNode = newListNode->next;
-
-            if (nodeIter->next) {
-                nodeIter = nodeIter->next;
-            } else {
-                if (nodeIter->offset + nodeIter->size == oldState->totalSize) {
-                    newNode->size += sizeDiff;
-                } else {
-                    freelistNode* newNodeEnd = getNode(list);
-                    newNodeEnd->next = 0;
-                    newNodeEnd->size = sizeDiff;
-                    newNodeEnd->offset = oldState->totalSize;
-                    newNode->next = newNodeEnd;
-                }
-                break;
-            }
+    // Hand the new space to the list. Merge it with the last node if it runs
+    // into the end of the old block.
+    if (sizeDiff) {
+        if (tail && tail->offset + tail->size == oldState->totalSize) {
+            setNodeSize(state, tail, tail->size + sizeDiff);
+        } else {
+            freelistNode* newNodeEnd = getNode(list);
+            newNodeEnd->size = sizeDiff;
+            newNodeEnd->offset = oldState->totalSize;
+            insertNode(state, tail, newNodeEnd);
         }
     }
 
@@ -254,17 +399,8 @@ void freelistClear(freelist* list) {
     }
 
     internalState* state = list->memory;
-    // Invalidate the nodes. This is how we will find an available one when we
-    // need it.
-    for (u64 i = 1; i < state->maxEntries; ++i) {
-        state->nodes[i].offset = INVALID_ID;
-        state->nodes[i].size = INVALID_ID;
-    }
-
     // Reset the head to occupy the entire thing.
-    state->head->offset = 0;
-    state->head->size = state->totalSize;
-    state->head->next = 0;
+    resetToOneNode(state);
 }
 
 u64 freelistFreeSpace(freelist* list) {
@@ -283,20 +419,153 @@ u64 freelistFreeSpace(freelist* list) {
     return total;
 }
 
-freelistNode* getNode(freelist* list) {
+u64 freelistLargestBlock(freelist* list) {
+    if (!list || !list->memory) {
+        return 0;
+    }
+
+    // Only the highest non-empty size bin can hold it
+    internalState* state = list->memory;
+    if (!state->sizeMask) {
+        return 0;
+    }
+    u64 largest = 0;
+    u32 bin = 63 - __builtin_clzll(state->sizeMask);
+    for (freelistNode* node = state->sizeBins[bin]; node;
+         node = node->sizeNext) {
+        if (node->size > largest) {
+            largest = node->size;
+        }
+    }
+
+    return largest;
+}
+
+u64 freelistNodeCount(freelist* list) {
+    if (!list || !list->memory) {
+        return 0;
+    }
+
+    u64 count = 0;
     internalState* state = list->memory;
-    for (u64 i = 1; i < state->maxEntries; ++i) {
-        if (state->nodes[i].offset == INVALID_ID) {
-            return &state->nodes[i];
+    freelistNode* node = state->head;
+    while (node) {
+        ++count;
+        node = node->next;
+    }
+
+    return count;
+}
+
+b8 freelistValidate(freelist* list) {
+    if (!list || !list->memory) {
+        return false;
+    }
+
+    internalState* state = list->memory;
+    u64 count = 0;
+    freelistNode* node = state->head;
+    while (node) {
+        // More nodes than exist means the list loops
+        if (++count > state->maxEntries) {
+            FERROR("freelistValidate: list has a cycle.");
+            return false;
+        }
+        if (node->size == 0 || node->offset + node->size > state->totalSize) {
+            FERROR("freelistValidate: node (offset: %llu, size: %llu) is "
+                   "empty or past the end (%llu).",
+                   node->offset, node->size, state->totalSize);
+            return false;
+        }
+        freelistNode* next = node->next;
+        if (next && next->prev != node) {
+            FERROR("freelistValidate: node at %llu has the wrong prev.",
+                   next->offset);
+            return false;
+        }
+        if (next) {
+            u64 end = node->offset + node->size;
+            if (next->offset < end) {
+                FERROR("freelistValidate: nodes at %llu and %llu are out of "
+                       "order or overlap.",
+                       node->offset, next->offset);
+                return false;
+            }
+            if (next->offset == end) {
+                FERROR("freelistValidate: nodes at %llu and %llu should have "
+                       "been merged.",
+                       node->offset, next->offset);
+                return false;
+            }
         }
+        node = next;
+    }
+
+    // Every node has to be in the bin of its size and nowhere else
+    u64 binned = 0;
+    for (u32 bin = 0; bin < FREELIST_SIZE_BIN_COUNT; ++bin) {
+        b8 hasNodes = state->sizeBins[bin] != 0;
+        if (hasNodes != ((state->sizeMask >> bin) & 1)) {
+            FERROR("freelistValidate: size bin %u doesn't match the mask.",
+                   bin);
+            return false;
+        }
+        freelistNode* previous = 0;
+        for (node = state->sizeBins[bin]; node; node = node->sizeNext) {
+            if (++binned > count || getSizeBin(node->size) != bin ||
+                node->sizePrev != previous) {
+                FERROR("freelistValidate: size bin %u is corrupted.", bin);
+                return false;
+            }
+            previous = node;
+        }
+    }
+    if (binned != count) {
+        FERROR("freelistValidate: %llu nodes are in the list but %llu are in "
+               "size bins.",
+               count, binned);
+        return false;
+    }
+    return true;
+}
+
+static void resetNodes(internalState* state) {
+    // Node 0 is always reserved for the head when the list is created/cleared
+    state->unusedNodes = 0;
+    state->nextFreshNode = 1;
+    for (u32 i = 0; i < FREELIST_SIZE_BIN_COUNT; ++i) {
+        state->sizeBins[i] = 0;
+    }
+    state->sizeMask = 0;
+}
+
+freelistNode* getNode(freelist* list) {
+    internalState* state = list->memory;
+    // Reuse a node that was given back first. Keeps the touched part of the
+    // node array small.
+    if (state->unusedNodes) {
+        freelistNode* node = state->unusedNodes;
+        state->unusedNodes = node->next;
+        node->next = 0;
+        return node;
+    }
+
+    if (state->nextFreshNode < state->maxEntries) {
+        freelistNode* node = &state->nodes[state->nextFreshNode++];
+        node->next = 0;
+        return node;
     }
 
     // Return nothing if no nodes are available.
+    FERROR("Freelist ran out of nodes (%llu). The block is too fragmented.",
+           state->maxEntries);
     return 0;
 }
 
 void invalidateNode(freelist* list, freelistNode* node) {
+    internalState* state = list->memory;
     node->offset = INVALID_ID;
     node->size = INVALID_ID;
-    node->next = 0;
+    node->next = state->unusedNodes;
+    state->unusedNodes = node;
 }
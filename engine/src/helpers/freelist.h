@@ -14,20 +14,58 @@ typedef struct freelist {
 CT_API void freelistCreate(u64 totalSize, u64* memoryReq, void* memory,
                            freelist* outList);
 
+/*
+ * Free ranges are kept in power of two size bins as well as in offset order.
+ * So an allocation takes a range from the smallest bin that is sure to fit
+ * instead of walking the list. Freeing still walks it to find the neighbours
+ * to merge with. `size` has to be above 0.
+ */
 CT_API b8 freelistAllocateBlock(freelist* list, u64 size, u64* outOffset);
 
+/*
+ * Same as `freelistAllocateBlock` except `outOffset` will be a multiple of
+ * `alignment` (power of 2). Skipped space stays free. The block is freed with
+ * `freelistFreeBlock` like any other.
+ */
+CT_API b8 freelistAllocateBlockAligned(freelist* list, u64 size,
+                                       u64 alignment, u64* outOffset);
+
+/*
+ * Allocates the exact range [offset, offset + size) if all of it is free.
+ * Used to grow a block into the free space right after it.
+ */
+CT_API b8 freelistAllocateBlockAt(freelist* list, u64 size, u64 offset);
+
 CT_API b8 freelistFreeBlock(freelist* list, u64 size, u64 offset);
 
 /*
- * `outOldMemory` must be freed externally
+ * Grows the freelist to `size`. The new space is added as free at the end.
+ * `outOldMemory` is set to the old block which must be freed externally
  */
 CT_API b8 freelistResize(freelist* list, u64* memoryReq, u64 size,
-                         void* newMemory, void* outOldMemory);
+                         void* newMemory, void** outOldMemory);
 
 CT_API void freelistClear(freelist* list);
 
 CT_API u64 freelistFreeSpace(freelist* list);
 
+/*
+ * Size of the biggest free range. Compared with `freelistFreeSpace` it shows
+ * how fragmented the list is.
+ */
+CT_API u64 freelistLargestBlock(freelist* list);
+
+/*
+ * Number of free ranges in the list
+ */
+CT_API u64 freelistNodeCount(freelist* list);
+
+/*
+ * Checks the free ranges are sorted, in bounds, don't overlap and are fully
+ * merged. Logs what is wrong and returns false if not. Walks the whole list.
+ */
+CT_API b8 freelistValidate(freelist* list);
+
 /*
  * Still need to free the memory yourself
  */
@@ -0,0 +1,381 @@
+#include "hashmap.h"
+
+#include "core/systems/fmemory.h"
+#include "core/systems/logger.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HASHMAP_SSE2
+#endif
+
+// Control byte values. Full slots hold 7 bits of the hash so they are >= 0,
+// both special values have the high bit set.
+#define CTRL_EMPTY ((i8)0x80)
+#define CTRL_DELETED ((i8)0xFE)
+
+#define HASHMAP_MIN_CAPACITY HASHMAP_GROUP_WIDTH
+
+// Bitmask with bit N set when ctrl[pos + N] matches
+typedef u32 groupMask;
+
+// Low bits pick the slot, high 7 bits go in the control byte
+static u64 h1(u64 hash) {
+    return hash;
+}
+
+static i8 h2(u64 hash) {
+    return (i8)(hash >> 57);
+}
+
+static groupMask matchByte(const i8* group, i8 value) {
+#ifdef HASHMAP_SSE2
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (groupMask)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(ctrl, _mm_set1_epi8(value)));
+#else
+    groupMask mask = 0;
+    for (u32 i = 0; i < HASHMAP_GROUP_WIDTH; ++i) {
+        mask |= (groupMask)(group[i] == value) << i;
+    }
+    return mask;
+#endif
+}
+
+// Slots that are empty or deleted. Both have the high bit set
+static groupMask matchFree(const i8* group) {
+#ifdef HASHMAP_SSE2
+    return (groupMask)_mm_movemask_epi8(
+        _mm_loadu_si128((const __m128i*)group));
+#else
+    groupMask mask = 0;
+    for (u32 i = 0; i < HASHMAP_GROUP_WIDTH; ++i) {
+        mask |= (groupMask)(group[i] < 0) << i;
+    }
+    return mask;
+#endif
+}
+
+u64 hashmapHashInt(u64 key) {
+    // murmur3 finalizer
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+u64 hashmapHashString(const char* key, u64 length) {
+    // FNV-1a, then mixed so the top bits are usable for the control byte
+    u64 hash = 0xcbf29ce484222325ULL;
+    for (u64 i = 0; i < length; ++i) {
+        hash ^= (u8)key[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hashmapHashInt(hash);
+}
+
+static u64 hashKey(hashmap* map, u64 key) {
+    if (map->stringKeys) {
+        const char* str = (const char*)key;
+        return hashmapHashString(str, strlen(str));
+    }
+    return hashmapHashInt(key);
+}
+
+// Max entries before growing. 7/8 load factor
+static u64 maxLoad(u64 capacity) {
+    return capacity - capacity / 8;
+}
+
+static void* valueAt(hashmap* map, u64 slot) {
+    return (u8*)map->values + slot * map->valueSize;
+}
+
+static void setCtrl(hashmap* map, u64 slot, i8 value) {
+    map->ctrl[slot] = value;
+    // Keep the mirrored bytes after the end in sync
+    if (slot < HASHMAP_GROUP_WIDTH) {
+        map->ctrl[map->capacity + slot] = value;
+    }
+}
+
+static b8 allocateSlots(hashmap* map, u64 capacity) {
+    u64 ctrlSize = capacity + HASHMAP_GROUP_WIDTH;
+    u64 size = ctrlSize + capacity * sizeof(u64) + capacity * map->valueSize;
+    // Only the control bytes have to be set, the rest is written on insert
+    void* block = fmallocEx(size, MEMORY_TAG_HASHMAP, FMALLOC_FLAG_NO_ZERO);
+    if (!block) {
+        return false;
+    }
+
+    map->ctrl = block;
+    // ctrlSize is a multiple of 16 so keys and values stay 16 byte aligned
+    map->keys = (u64*)((u8*)block + ctrlSize);
+    map->values = (u8*)map->keys + capacity * sizeof(u64);
+    map->capacity = capacity;
+    map->count = 0;
+    map->growthLeft = maxLoad(capacity);
+    fsetMem(map->ctrl, CTRL_EMPTY, ctrlSize);
+    return true;
+}
+
+// First free slot on `hash`'s probe sequence
+static u64 findFreeSlot(hashmap* map, u64 hash) {
+    u64 mask = map->capacity - 1;
+    u64 pos = h1(hash) & mask;
+    u64 stride = 0;
+    for (;;) {
+        groupMask free = matchFree(&map->ctrl[pos]);
+        if (free) {
+            return (pos + __builtin_ctz(free)) & mask;
+        }
+        // Triangular probing visits every group once for power of 2 sizes
+        stride += HASHMAP_GROUP_WIDTH;
+        pos = (pos + stride) & mask;
+    }
+}
+
+static b8 keysEqual(hashmap* map, u64 stored, u64 key, u64 length) {
+    if (!map->stringKeys) {
+        return stored == key;
+    }
+    const char* storedStr = (const char*)stored;
+    return strncmp(storedStr, (const char*)key, length) == 0 &&
+           storedStr[length] == 0;
+}
+
+// Slot holding `key` or INVALID_ID. `length` is only used for string keys
+static u64 findSlot(hashmap* map, u64 key, u64 length, u64 hash) {
+    u64 mask = map->capacity - 1;
+    u64 pos = h1(hash) & mask;
+    u64 stride = 0;
+    i8 tag = h2(hash);
+    for (;;) {
+        const i8* group = &map->ctrl[pos];
+        groupMask match = matchByte(group, tag);
+        while (match) {
+            u64 slot = (pos + __builtin_ctz(match)) & mask;
+            if (keysEqual(map, map->keys[slot], key, length)) {
+                return slot;
+            }
+            match &= match - 1;
+        }
+        // An empty slot ends the probe sequence, the key would have gone there
+        if (matchByte(group, CTRL_EMPTY)) {
+            return INVALID_ID;
+        }
+        stride += HASHMAP_GROUP_WIDTH;
+        pos = (pos + stride) & mask;
+        if (stride > map->capacity) {
+            return INVALID_ID;
+        }
+    }
+}
+
+// Moves every entry to a table of `capacity` slots. Also clears out the
+// deleted slots.
+static b8 rehash(hashmap* map, u64 capacity) {
+    hashmap old = *map;
+    if (!allocateSlots(map, capacity)) {
+        *map = old;
+        return false;
+    }
+
+    for (u64 i = 0; i < old.capacity; ++i) {
+        if (old.ctrl[i] < 0) {
+            continue;
+        }
+        u64 hash = hashKey(map, old.keys[i]);
+        u64 slot = findFreeSlot(map, hash);
+        setCtrl(map, slot, h2(hash));
+        map->keys[slot] = old.keys[i];
+        if (map->valueSize) {
+            fcpyMem(valueAt(map, slot),
+                    (u8*)old.values + i * old.valueSize, map->valueSize);
+        }
+    }
+    map->count = old.count;
+    map->growthLeft -= old.count;
+
+    ffree(old.ctrl);
+    return true;
+}
+
+static void* insertHashed(hashmap* map, u64 key, u64 length, u64 hash,
+                          const void* value) {
+    u64 slot = findSlot(map, key, length, hash);
+    if (slot == INVALID_ID) {
+        slot = findFreeSlot(map, hash);
+        // Reusing a deleted slot doesn't use up any growth
+        if (map->growthLeft == 0 && map->ctrl[slot] == CTRL_EMPTY) {
+            // Mostly deleted slots means a same size rehash is enough.
+            // Under 25/32 full leaves room for a good few inserts after.
+            u64 capacity = map->count * 32 <= map->capacity * 25
+                               ? map->capacity
+                               : map->capacity * 2;
+            if (!rehash(map, capacity)) {
+                FERROR("hashmap failed to grow to %llu slots.", capacity);
+                return 0;
+            }
+            slot = findFreeSlot(map, hash);
+        }
+        if (map->ctrl[slot] == CTRL_EMPTY) {
+            --map->growthLeft;
+        }
+        setCtrl(map, slot, h2(hash));
+        map->keys[slot] = key;
+        ++map->count;
+    }
+
+    void* stored = valueAt(map, slot);
+    if (value && map->valueSize) {
+        fcpyMem(stored, value, map->valueSize);
+    }
+    return stored;
+}
+
+static b8 removeSlot(hashmap* map, u64 slot) {
+    if (slot == INVALID_ID) {
+        return false;
+    }
+    // If every group window holding this slot has an empty slot, no probe
+    // sequence ever went past it, so it can go straight back to empty.
+    u64 mask = map->capacity - 1;
+    u64 before = (slot - HASHMAP_GROUP_WIDTH) & mask;
+    groupMask emptyBefore = matchByte(&map->ctrl[before], CTRL_EMPTY);
+    groupMask emptyAfter = matchByte(&map->ctrl[slot], CTRL_EMPTY);
+    // Full slots right before `slot` and from `slot` on
+    u32 fullBefore = emptyBefore ? __builtin_clz(emptyBefore) - 16 : 16;
+    u32 fullAfter = emptyAfter ? __builtin_ctz(emptyAfter) : 16;
+    if (fullBefore + fullAfter < HASHMAP_GROUP_WIDTH) {
+        setCtrl(map, slot, CTRL_EMPTY);
+        ++map->growthLeft;
+    } else {
+        setCtrl(map, slot, CTRL_DELETED);
+    }
+    --map->count;
+    return true;
+}
+
+b8 hashmapCreate(u64 valueSize, u64 initialCapacity, b8 stringKeys,
+                 hashmap* outMap) {
+    if (!outMap) {
+        FERROR("hashmapCreate needs a map.");
+        return false;
+    }
+
+    // Enough slots to hold `initialCapacity` under the load factor
+    u64 capacity = HASHMAP_MIN_CAPACITY;
+    while (maxLoad(capacity) < initialCapacity) {
+        capacity *= 2;
+    }
+
+    outMap->valueSize = valueSize;
+    outMap->stringKeys = stringKeys;
+    return allocateSlots(outMap, capacity);
+}
+
+void hashmapDestroy(hashmap* map) {
+    if (!map) {
+        return;
+    }
+    ffree(map->ctrl);
+    map->ctrl = 0;
+    map->keys = 0;
+    map->values = 0;
+    map->capacity = 0;
+    map->count = 0;
+    map->growthLeft = 0;
+}
+
+void* hashmapInsert(hashmap* map, u64 key, const void* value) {
+    if (map->stringKeys) {
+        FERROR("hashmapInsert called on a string map. Use hashmapInsertStr.");
+        return 0;
+    }
+    return insertHashed(map, key, 0, hashmapHashInt(key), value);
+}
+
+void* hashmapGet(hashmap* map, u64 key) {
+    if (map->stringKeys) {
+        FERROR("hashmapGet called on a string map. Use hashmapGetStr.");
+        return 0;
+    }
+    u64 slot = findSlot(map, key, 0, hashmapHashInt(key));
+    return slot == INVALID_ID ? 0 : valueAt(map, slot);
+}
+
+b8 hashmapRemove(hashmap* map, u64 key) {
+    if (map->stringKeys) {
+        FERROR("hashmapRemove called on a string map. Use hashmapRemoveStr.");
+        return false;
+    }
+    return removeSlot(map, findSlot(map, key, 0, hashmapHashInt(key)));
+}
+
+void* hashmapInsertStr(hashmap* map, const char* key, const void* value) {
+    u64 length = strlen(key);
+    return hashmapInsertStrHashed(map, key, length,
+                                  hashmapHashString(key, length), value);
+}
+
+void* hashmapGetStr(hashmap* map, const char* key) {
+    u64 length = strlen(key);
+    return hashmapGetStrHashed(map, key, length,
+                               hashmapHashString(key, length));
+}
+
+b8 hashmapRemoveStr(hashmap* map, const char* key) {
+    if (!map->stringKeys) {
+        FERROR("hashmapRemoveStr called on an int map. Use hashmapRemove.");
+        return false;
+    }
+    u64 length = strlen(key);
+    return removeSlot(map, findSlot(map, (u64)key, length,
+                                    hashmapHashString(key, length)));
+}
+
+void* hashmapGetStrHashed(hashmap* map, const char* key, u64 length,
+                          u64 hash) {
+    if (!map->stringKeys) {
+        FERROR("hashmapGetStr called on an int map. Use hashmapGet.");
+        return 0;
+    }
+    u64 slot = findSlot(map, (u64)key, length, hash);
+    return slot == INVALID_ID ? 0 : valueAt(map, slot);
+}
+
+void* hashmapInsertStrHashed(hashmap* map, const char* key, u64 length,
+                             u64 hash, const void* value) {
+    if (!map->stringKeys) {
+        FERROR("hashmapInsertStr called on an int map. Use hashmapInsert.");
+        return 0;
+    }
+    return insertHashed(map, (u64)key, length, hash, value);
+}
+
+void hashmapClear(hashmap* map) {
+    fsetMem(map->ctrl, CTRL_EMPTY, map->capacity + HASHMAP_GROUP_WIDTH);
+    map->count = 0;
+    map->growthLeft = maxLoad(map->capacity);
+}
+
+b8 hashmapIterate(hashmap* map, u64* iterator, u64* outKey, void** outValue) {
+    for (u64 i = *iterator; i < map->capacity; ++i) {
+        if (map->ctrl[i] >= 0) {
+            *iterator = i + 1;
+            if (outKey) {
+                *outKey = map->keys[i];
+            }
+            if (outValue) {
+                *outValue = valueAt(map, i);
+            }
+            return true;
+        }
+    }
+    *iterator = map->capacity;
+    return false;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "defines.h"
+
+/*
+ * Open addressing hash map with SwissTable style control bytes. Every slot has
+ * one control byte (empty, deleted or 7 bits of the key's hash) and lookups
+ * compare 16 of them at once, so most misses never touch a key.
+ *
+ * Keys are either u64s or strings. String maps only store the pointer, the
+ * string has to outlive its entry. Values are copied in and live in one array
+ * so they stay cache friendly. Pointers to values are only valid until the
+ * next insert.
+ */
+
+// Control bytes checked per probe step
+#define HASHMAP_GROUP_WIDTH 16
+
+typedef struct hashmap {
+    // `capacity` control bytes, then the first HASHMAP_GROUP_WIDTH mirrored so
+    // a group can be loaded from any slot without wrapping
+    i8* ctrl;
+    // u64 keys or `const char*` for string maps
+    u64* keys;
+    void* values;
+    // Power of 2, at least HASHMAP_GROUP_WIDTH
+    u64 capacity;
+    u64 count;
+    // Inserts left before the map has to rehash. Deleted slots count as used
+    u64 growthLeft;
+    u64 valueSize;
+    b8 stringKeys;
+} hashmap;
+
+/**
+ * @brief Creates a hash map. Memory comes from the memory system.
+ * @param valueSize Size of one value in bytes. Can be 0 for a set
+ * @param initialCapacity Entries it can hold before it grows. 0 for the minimum
+ * @param stringKeys true for `hashmap...Str` keys, false for u64 keys
+ * @param outMap The map to set up
+ * @returns true if successful, false if failed
+ */
+CT_API b8 hashmapCreate(u64 valueSize, u64 initialCapacity, b8 stringKeys,
+                        hashmap* outMap);
+
+CT_API void hashmapDestroy(hashmap* map);
+
+/**
+ * @brief Inserts `key` or overwrites its value if it's already in the map.
+ * @param value Copied in. Can be 0 to leave the value unset/unchanged
+ * @returns pointer to the stored value, 0 if failed
+ */
+CT_API void* hashmapInsert(hashmap* map, u64 key, const void* value);
+
+/**
+ * @returns pointer to the stored value, 0 if `key` isn't in the map
+ */
+CT_API void* hashmapGet(hashmap* map, u64 key);
+
+/**
+ * @returns true if `key` was in the map
+ */
+CT_API b8 hashmapRemove(hashmap* map, u64 key);
+
+// Same as above for maps made with `stringKeys`
+CT_API void* hashmapInsertStr(hashmap* map, const char* key, const void* value);
+CT_API void* hashmapGetStr(hashmap* map, const char* key);
+CT_API b8 hashmapRemoveStr(hashmap* map, const char* key);
+
+/**
+ * @brief Versions that take a hash from `hashmapHashString` so callers that
+ * already hashed the string don't hash it again. `length` is the string's
+ * length. Get's key doesn't have to be null terminated, Insert's does since
+ * stored keys are compared and rehashed as C strings.
+ */
+CT_API void* hashmapGetStrHashed(hashmap* map, const char* key, u64 length,
+                                 u64 hash);
+CT_API void* hashmapInsertStrHashed(hashmap* map, const char* key, u64 length,
+                                    u64 hash, const void* value);
+
+/**
+ * @brief Removes every entry. Keeps the memory.
+ */
+CT_API void hashmapClear(hashmap* map);
+
+/**
+ * @brief Walks every entry. Start with `*iterator` at 0. Don't insert while
+ * iterating, removing the current entry is fine.
+ * @param outKey The key (a `const char*` for string maps). Can be 0
+ * @param outValue Pointer to the value. Can be 0
+ * @returns false when there are no entries left
+ */
+CT_API b8 hashmapIterate(hashmap* map, u64* iterator, u64* outKey,
+                         void** outValue);
+
+CT_API u64 hashmapHashInt(u64 key);
+CT_API u64 hashmapHashString(const char* key, u64 length);
@@ -0,0 +1,172 @@
+#include "ringQueue.h"
+
+#include "core/systems/fmemory.h"
+#include "core/systems/logger.h"
+
+static u64 roundUpPow2(u64 value) {
+    u64 result = 2;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+b8 spscQueueCreate(u64 elementSize, u64 capacity, u64* memoryReq,
+                   void* memory, spscQueue* outQueue) {
+    if (elementSize == 0 || capacity == 0) {
+        FERROR("spscQueueCreate needs an element size and capacity above 0.");
+        return false;
+    }
+    capacity = roundUpPow2(capacity);
+    *memoryReq = capacity * elementSize;
+    if (!memory) {
+        return true;
+    }
+
+    outQueue->buffer = memory;
+    outQueue->mask = capacity - 1;
+    outQueue->elementSize = elementSize;
+    atomic_init(&outQueue->head, 0);
+    outQueue->cachedTail = 0;
+    atomic_init(&outQueue->tail, 0);
+    outQueue->cachedHead = 0;
+    return true;
+}
+
+b8 spscQueuePush(spscQueue* queue, const void* element) {
+    u64 tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    if (tail - queue->cachedHead > queue->mask) {
+        // Looks full. Only now go look at what the consumer has done
+        queue->cachedHead =
+            atomic_load_explicit(&queue->head, memory_order_acquire);
+        if (tail - queue->cachedHead > queue->mask) {
+            return false;
+        }
+    }
+
+    fcpyMem(queue->buffer + (tail & queue->mask) * queue->elementSize, element,
+            queue->elementSize);
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+b8 spscQueuePop(spscQueue* queue, void* outElement) {
+    u64 head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    if (head == queue->cachedTail) {
+        queue->cachedTail =
+            atomic_load_explicit(&queue->tail, memory_order_acquire);
+        if (head == queue->cachedTail) {
+            return false;
+        }
+    }
+
+    fcpyMem(outElement, queue->buffer + (head & queue->mask) * queue->elementSize,
+            queue->elementSize);
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
+
+u64 spscQueueCount(spscQueue* queue) {
+    u64 head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    u64 tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    return tail - head;
+}
+
+// The sequence number is the first 8 bytes of a cell, the element follows
+static atomic_ullong* cellSequence(mpmcQueue* queue, u64 pos) {
+    return (atomic_ullong*)(queue->cells + (pos & queue->mask) * queue->cellStride);
+}
+
+static void* cellData(atomic_ullong* sequence) {
+    return (u8*)sequence + sizeof(u64);
+}
+
+b8 mpmcQueueCreate(u64 elementSize, u64 capacity, u64* memoryReq,
+                   void* memory, mpmcQueue* outQueue) {
+    if (elementSize == 0 || capacity == 0) {
+        FERROR("mpmcQueueCreate needs an element size and capacity above 0.");
+        return false;
+    }
+    capacity = roundUpPow2(capacity);
+    u64 cellStride = (sizeof(u64) + elementSize + 7) & ~7ULL;
+    *memoryReq = capacity * cellStride;
+    if (!memory) {
+        return true;
+    }
+
+    outQueue->cells = memory;
+    outQueue->mask = capacity - 1;
+    outQueue->elementSize = elementSize;
+    outQueue->cellStride = cellStride;
+    // Cell N is free for the push at position N
+    for (u64 i = 0; i < capacity; ++i) {
+        atomic_init(cellSequence(outQueue, i), i);
+    }
+    atomic_init(&outQueue->enqueuePos, 0);
+    atomic_init(&outQueue->dequeuePos, 0);
+    return true;
+}
+
+b8 mpmcQueuePush(mpmcQueue* queue, const void* element) {
+    atomic_ullong* sequence;
+    u64 pos = atomic_load_explicit(&queue->enqueuePos, memory_order_relaxed);
+    for (;;) {
+        sequence = cellSequence(queue, pos);
+        u64 seq = atomic_load_explicit(sequence, memory_order_acquire);
+        i64 diff = (i64)seq - (i64)pos;
+        if (diff == 0) {
+            // Cell is free, claim the position
+            if (atomic_compare_exchange_weak_explicit(
+                    &queue->enqueuePos, &pos, pos + 1, memory_order_relaxed,
+                    memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Still holds the element from a lap ago, the queue is full
+            return false;
+        } else {
+            // Another producer took it
+            pos = atomic_load_explicit(&queue->enqueuePos, memory_order_relaxed);
+        }
+    }
+
+    fcpyMem(cellData(sequence), element, queue->elementSize);
+    // Hand the cell to the consumer of this position
+    atomic_store_explicit(sequence, pos + 1, memory_order_release);
+    return true;
+}
+
+b8 mpmcQueuePop(mpmcQueue* queue, void* outElement) {
+    atomic_ullong* sequence;
+    u64 pos = atomic_load_explicit(&queue->dequeuePos, memory_order_relaxed);
+    for (;;) {
+        sequence = cellSequence(queue, pos);
+        u64 seq = atomic_load_explicit(sequence, memory_order_acquire);
+        i64 diff = (i64)seq - (i64)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(
+                    &queue->dequeuePos, &pos, pos + 1, memory_order_relaxed,
+                    memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Nothing pushed here yet, the queue is empty
+            return false;
+        } else {
+            pos = atomic_load_explicit(&queue->dequeuePos, memory_order_relaxed);
+        }
+    }
+
+    fcpyMem(outElement, cellData(sequence), queue->elementSize);
+    // Free the cell for the push one lap later
+    atomic_store_explicit(sequence, pos + queue->mask + 1, memory_order_release);
+    return true;
+}
+
+u64 mpmcQueueCount(mpmcQueue* queue) {
+    u64 dequeuePos =
+        atomic_load_explicit(&queue->dequeuePos, memory_order_acquire);
+    u64 enqueuePos =
+        atomic_load_explicit(&queue->enqueuePos, memory_order_acquire);
+    return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+}
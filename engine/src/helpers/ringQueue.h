@@ -0,0 +1,107 @@
+#pragma once
+
+#include "defines.h"
+
+#include <stdatomic.h>
+
+/*
+ * Bounded lock-free ring buffers. Elements are copied in and out by value.
+ *
+ * spscQueue: one producer thread and one consumer thread. Each side only
+ * writes its own index and keeps a cached copy of the other one, so the hot
+ * path doesn't touch the other thread's cache line.
+ *
+ * mpmcQueue: any number of producers and consumers (Dmitry Vyukov's bounded
+ * queue). Every cell has a sequence number that says whose turn it is, so a
+ * push/pop is one CAS on its index plus the copy.
+ *
+ * Like the freelist the memory is given to the queue. Call create with
+ * `memory` = 0 to get `memoryReq`, then again with a block that size (8 byte
+ * aligned). There is no destroy FN, free the memory yourself once no thread
+ * uses the queue.
+ */
+
+// Indices written by different threads are kept at least this far apart
+#define RING_QUEUE_CACHE_LINE 64
+
+typedef struct spscQueue {
+    u8* buffer;
+    u64 mask;
+    u64 elementSize;
+    u8 pad0[RING_QUEUE_CACHE_LINE];
+
+    // Consumer side
+    atomic_ullong head;
+    u64 cachedTail;
+    u8 pad1[RING_QUEUE_CACHE_LINE];
+
+    // Producer side
+    atomic_ullong tail;
+    u64 cachedHead;
+    u8 pad2[RING_QUEUE_CACHE_LINE];
+} spscQueue;
+
+typedef struct mpmcQueue {
+    u8* cells;
+    u64 mask;
+    u64 elementSize;
+    // Bytes per cell, sequence number + element rounded up to 8
+    u64 cellStride;
+    u8 pad0[RING_QUEUE_CACHE_LINE];
+
+    atomic_ullong enqueuePos;
+    u8 pad1[RING_QUEUE_CACHE_LINE];
+
+    atomic_ullong dequeuePos;
+    u8 pad2[RING_QUEUE_CACHE_LINE];
+} mpmcQueue;
+
+/**
+ * @brief Creates a single producer/single consumer queue.
+ * @param capacity Max elements in the queue. Rounded up to a power of 2
+ * @param memoryReq out How many bytes `memory` has to be
+ * @param memory Block for the elements. 0 to only get `memoryReq`
+ * @returns true if the queue was created
+ */
+CT_API b8 spscQueueCreate(u64 elementSize, u64 capacity, u64* memoryReq,
+                          void* memory, spscQueue* outQueue);
+
+/**
+ * @brief Producer thread only.
+ * @returns false if the queue is full
+ */
+CT_API b8 spscQueuePush(spscQueue* queue, const void* element);
+
+/**
+ * @brief Consumer thread only.
+ * @returns false if the queue is empty
+ */
+CT_API b8 spscQueuePop(spscQueue* queue, void* outElement);
+
+// Elements in the queue. Only a snapshot if the other side is running
+CT_API u64 spscQueueCount(spscQueue* queue);
+
+/**
+ * @brief Creates a multi producer/multi consumer queue.
+ * @param capacity Max elements in the queue. Rounded up to a power of 2
+ * @param memoryReq out How many bytes `memory` has to be
+ * @param memory Block for the cells. 0 to only get `memoryReq`
+ * @returns true if the queue was created
+ */
+CT_API b8 mpmcQueueCreate(u64 elementSize, u64 capacity, u64* memoryReq,
+                          void* memory, mpmcQueue* outQueue);
+
+/**
+ * @brief Safe from any thread.
+ * @returns false if the queue is full
+ */
+CT_API b8 mpmcQueuePush(mpmcQueue* queue, const void* element);
+
+/**
+ * @brief Safe from any thread.
+ * @returns false if the queue is empty
+ */
+CT_API b8 mpmcQueuePop(mpmcQueue* queue, void* outElement);
+
+// Elements in the queue. Only a snapshot if other threads are running
+CT_API u64 mpmcQueueCount(mpmcQueue* queue);
@@ -0,0 +1,190 @@
+#include "slotmap.h"
+
+#include "core/systems/fmemory.h"
+#include "core/systems/logger.h"
+
+#define SLOTMAP_MIN_CAPACITY 16
+
+static slotHandle makeHandle(u32 index, u32 generation) {
+    return ((u64)generation << 32) | index;
+}
+
+static u32 handleIndex(slotHandle handle) {
+    return (u32)handle;
+}
+
+static u32 handleGeneration(slotHandle handle) {
+    return (u32)(handle >> 32);
+}
+
+static void* valueAt(slotmap* map, u32 denseIndex) {
+    return (u8*)map->values + (u64)denseIndex * map->valueSize;
+}
+
+// Moves everything into one block of `capacity` entries. The slots, the dense
+// to slot indices and the values are laid out back to back
+static b8 setCapacity(slotmap* map, u32 capacity) {
+    u64 slotsSize = sizeof(slotEntry) * (u64)capacity;
+    u64 denseToSlotSize = sizeof(u32) * (u64)capacity;
+    // Keeps the values 8 byte aligned
+    denseToSlotSize = (denseToSlotSize + 7) & ~7ULL;
+    u8* block = fmallocEx(slotsSize + denseToSlotSize + map->valueSize * capacity,
+                          MEMORY_TAG_ARRAY, FMALLOC_FLAG_NO_ZERO);
+    if (!block) {
+        FERROR("Failed to allocate memory for a slotmap of %u values.",
+               capacity);
+        return false;
+    }
+
+    slotEntry* slots = (slotEntry*)block;
+    u32* denseToSlot = (u32*)(block + slotsSize);
+    void* values = block + slotsSize + denseToSlotSize;
+    if (map->slots) {
+        fcpyMem(slots, map->slots, sizeof(slotEntry) * map->slotCount);
+        fcpyMem(denseToSlot, map->denseToSlot, sizeof(u32) * map->count);
+        fcpyMem(values, map->values, map->valueSize * map->count);
+        ffree(map->slots);
+    }
+    map->slots = slots;
+    map->denseToSlot = denseToSlot;
+    map->values = values;
+    map->capacity = capacity;
+    return true;
+}
+
+b8 slotmapCreate(u64 valueSize, u32 initialCapacity, slotmap* outMap) {
+    if (!outMap || valueSize == 0) {
+        FERROR("slotmapCreate needs a map and a value size above 0.");
+        return false;
+    }
+    outMap->slots = 0;
+    outMap->denseToSlot = 0;
+    outMap->values = 0;
+    outMap->valueSize = valueSize;
+    outMap->count = 0;
+    outMap->slotCount = 0;
+    outMap->freeHead = INVALID_ID;
+    return setCapacity(outMap, initialCapacity > SLOTMAP_MIN_CAPACITY
+                                   ? initialCapacity
+                                   : SLOTMAP_MIN_CAPACITY);
+}
+
+void slotmapDestroy(slotmap* map) {
+    if (!map) {
+        return;
+    }
+    ffree(map->slots);
+    map->slots = 0;
+    map->denseToSlot = 0;
+    map->values = 0;
+    map->count = 0;
+    map->capacity = 0;
+    map->slotCount = 0;
+    map->freeHead = INVALID_ID;
+}
+
+slotHandle slotmapInsert(slotmap* map, const void* value, void** outValue) {
+    if (map->count == map->capacity) {
+        if (map->capacity >= INVALID_ID / 2) {
+            FERROR("slotmap is full.");
+            return SLOT_HANDLE_INVALID;
+        }
+        if (!setCapacity(map, map->capacity * 2)) {
+            return SLOT_HANDLE_INVALID;
+        }
+    }
+
+    // Reuse a freed slot first. A slot is only new when none are free, so
+    // slotCount never passes capacity
+    u32 slotIndex;
+    if (map->freeHead != INVALID_ID) {
+        slotIndex = map->freeHead;
+        map->freeHead = map->slots[slotIndex].denseIndex;
+    } else {
+        slotIndex = map->slotCount++;
+        map->slots[slotIndex].generation = 1;
+    }
+
+    u32 denseIndex = map->count++;
+    slotEntry* slot = &map->slots[slotIndex];
+    slot->denseIndex = denseIndex;
+    map->denseToSlot[denseIndex] = slotIndex;
+
+    void* stored = valueAt(map, denseIndex);
+    if (value) {
+        fcpyMem(stored, value, map->valueSize);
+    } else {
+        fzeroMemory(stored, map->valueSize);
+    }
+    if (outValue) {
+        *outValue = stored;
+    }
+    return makeHandle(slotIndex, slot->generation);
+}
+
+// Slot for `handle` or 0 if the handle is stale/invalid
+static slotEntry* getSlot(slotmap* map, slotHandle handle) {
+    u32 index = handleIndex(handle);
+    if (index >= map->slotCount) {
+        return 0;
+    }
+    slotEntry* slot = &map->slots[index];
+    // Free slots already have the generation their next handle will get, so
+    // the dense index has to point back at this slot too
+    if (slot->generation != handleGeneration(handle) ||
+        slot->denseIndex >= map->count ||
+        map->denseToSlot[slot->denseIndex] != index) {
+        return 0;
+    }
+    return slot;
+}
+
+void* slotmapGet(slotmap* map, slotHandle handle) {
+    slotEntry* slot = getSlot(map, handle);
+    return slot ? valueAt(map, slot->denseIndex) : 0;
+}
+
+// Frees the slot and makes every handle to it stale
+static void releaseSlot(slotmap* map, u32 slotIndex) {
+    slotEntry* slot = &map->slots[slotIndex];
+    if (++slot->generation == 0) {
+        slot->generation = 1;
+    }
+    slot->denseIndex = map->freeHead;
+    map->freeHead = slotIndex;
+}
+
+b8 slotmapRemove(slotmap* map, slotHandle handle) {
+    slotEntry* slot = getSlot(map, handle);
+    if (!slot) {
+        return false;
+    }
+
+    // Swap and pop. Move the last value into the hole
+    u32 denseIndex = slot->denseIndex;
+    u32 last = --map->count;
+    if (denseIndex != last) {
+        fcpyMem(valueAt(map, denseIndex), valueAt(map, last), map->valueSize);
+        u32 movedSlot = map->denseToSlot[last];
+        map->denseToSlot[denseIndex] = movedSlot;
+        map->slots[movedSlot].denseIndex = denseIndex;
+    }
+
+    releaseSlot(map, handleIndex(handle));
+    return true;
+}
+
+void slotmapClear(slotmap* map) {
+    for (u32 i = 0; i < map->count; ++i) {
+        releaseSlot(map, map->denseToSlot[i]);
+    }
+    map->count = 0;
+}
+
+slotHandle slotmapHandleAt(slotmap* map, u32 denseIndex) {
+    if (denseIndex >= map->count) {
+        return SLOT_HANDLE_INVALID;
+    }
+    u32 slotIndex = map->denseToSlot[denseIndex];
+    return makeHandle(slotIndex, map->slots[slotIndex].generation);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "defines.h"
+
+/*
+ * Slot map (sparse set). Values are kept packed in one dense array so
+ * iterating is a plain loop, and are found through stable handles that stay
+ * valid while other values are added/removed. Insert, remove and lookup are
+ * all O(1). Removing moves the last value into the hole (swap and pop) so the
+ * order of the dense array isn't kept.
+ *
+ * A handle is the slot index in the low 32 bits and the slot's generation in
+ * the high 32 bits. Removing bumps the generation, so handles to removed
+ * values stop working instead of pointing at whatever reused the slot.
+ */
+
+typedef u64 slotHandle;
+
+// Never given out, generations start at 1
+#define SLOT_HANDLE_INVALID 0
+
+typedef struct slotEntry {
+    // Index into the dense array, or the next free slot if the slot is free
+    u32 denseIndex;
+    u32 generation;
+} slotEntry;
+
+typedef struct slotmap {
+    slotEntry* slots;
+    // Slot index of every dense value, used to fix the slot up on swap and pop
+    u32* denseToSlot;
+    void* values;
+    u64 valueSize;
+    u32 count;
+    u32 capacity;
+    // Slots ever used. Slots past this are untouched
+    u32 slotCount;
+    // Head of the free slot list, INVALID_ID if empty
+    u32 freeHead;
+} slotmap;
+
+/**
+ * @brief Creates a slot map. Memory comes from the memory system.
+ * @param valueSize Size of one value in bytes
+ * @param initialCapacity Values it can hold before it grows. 0 for the minimum
+ * @param outMap The map to set up
+ * @returns true if successful, false if failed
+ */
+CT_API b8 slotmapCreate(u64 valueSize, u32 initialCapacity, slotmap* outMap);
+
+CT_API void slotmapDestroy(slotmap* map);
+
+/**
+ * @brief Adds a value.
+ * @param value Copied in. Can be 0 to leave it zeroed
+ * @param outValue Set to the stored value. Can be 0. Only valid until the
+ * next insert/remove
+ * @returns the handle, SLOT_HANDLE_INVALID if failed
+ */
+CT_API slotHandle slotmapInsert(slotmap* map, const void* value,
+                                void** outValue);
+
+/**
+ * @returns pointer to the value, 0 if the handle is stale/invalid. Only valid
+ * until the next insert/remove
+ */
+CT_API void* slotmapGet(slotmap* map, slotHandle handle);
+
+/**
+ * @returns true if the handle was valid and its value was removed
+ */
+CT_API b8 slotmapRemove(slotmap* map, slotHandle handle);
+
+/**
+ * @brief Removes every value. Every handle given out so far goes stale.
+ */
+CT_API void slotmapClear(slotmap* map);
+
+/**
+ * @brief Handle of the value at `denseIndex` in `map->values`. Use it to get
+ * a handle while iterating the dense array.
+ */
+CT_API slotHandle slotmapHandleAt(slotmap* map, u32 denseIndex);
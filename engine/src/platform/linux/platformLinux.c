@@ -12,7 +12,10 @@
 #include <X11/Xlib-xcb.h> // system install libxkbcommon-x11-dev
 #include <X11/Xlib.h>
 #include <X11/keysym.h>
+#include <pthread.h>
+#include <sys/mman.h>
 #include <sys/time.h>
+#include <unistd.h> // sysconf
 #include <xcb/xcb.h>
 
 #if _POSIX_C_SOURCE >= 199309L
@@ -257,7 +260,8 @@ b8 platformPumpMessages() {
                 EventContext ec;
                 ec.data.u16[0] = cfgNotifyEvent->width;
                 ec.data.u16[1] = cfgNotifyEvent->height;
-                eventFire(EVENT_CODE_RESIZED, 0, ec);
+                // Dragging the window edge sends a stream of these
+                eventPost(EVENT_CODE_RESIZED, 0, ec);
                 break;
             }
 
@@ -284,11 +288,64 @@ b8 platformPumpMessages() {
 }
 
 void* platformAllocate(u64 size, b8 aligned) {
+    if (aligned) {
+        return platformAllocateAligned(size, PLATFORM_DEFAULT_ALIGNMENT);
+    }
     return malloc(size);
 }
+void* platformAllocateAligned(u64 size, u64 alignment) {
+    // posix_memalign needs at least pointer alignment
+    if (alignment < sizeof(void*)) {
+        alignment = sizeof(void*);
+    }
+    void* block = 0;
+    if (posix_memalign(&block, alignment, size) != 0) {
+        return 0;
+    }
+    return block;
+}
 void platformFree(void* block, b8 aligned) {
     free(block);
 }
+void* platformAllocatePages(u64 size) {
+    // NORESERVE so a big pool doesn't count against overcommit until used
+    void* block = mmap(0, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (block == MAP_FAILED) {
+        FERROR("platformAllocatePages failed to map %llu bytes.", size);
+        return 0;
+    }
+    return block;
+}
+void platformFreePages(void* block, u64 size) {
+    if (block) {
+        munmap(block, size);
+    }
+}
+void* platformReserveMemory(u64 size) {
+    void* block = mmap(0, size, PROT_NONE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (block == MAP_FAILED) {
+        FERROR("platformReserveMemory failed to reserve %llu bytes.", size);
+        return 0;
+    }
+    return block;
+}
+b8 platformCommitMemory(void* block, u64 size) {
+    if (mprotect(block, size, PROT_READ | PROT_WRITE) != 0) {
+        FERROR("platformCommitMemory failed to commit %llu bytes.", size);
+        return false;
+    }
+    return true;
+}
+void platformReleaseMemory(void* block, u64 size) {
+    if (block) {
+        munmap(block, size);
+    }
+}
+u64 platformGetPageSize() {
+    return (u64)sysconf(_SC_PAGESIZE);
+}
 void* platformZeroMemory(void* block, u64 size) {
     return memset(block, 0, size);
 }
@@ -299,6 +356,45 @@ void* platformSetMemory(void* dest, i32 value, u64 size) {
     return memset(dest, value, size);
 }
 
+b8 platformMutexCreate(PlatformMutex* outMutex) {
+    if (!outMutex) {
+        return false;
+    }
+    pthread_mutex_t* mutex = platformAllocate(sizeof(pthread_mutex_t), false);
+    if (!mutex) {
+        return false;
+    }
+    if (pthread_mutex_init(mutex, 0) != 0) {
+        FERROR("Failed to create mutex.");
+        platformFree(mutex, false);
+        return false;
+    }
+    outMutex->internalData = mutex;
+    return true;
+}
+
+void platformMutexDestroy(PlatformMutex* mutex) {
+    if (mutex && mutex->internalData) {
+        pthread_mutex_destroy(mutex->internalData);
+        platformFree(mutex->internalData, false);
+        mutex->internalData = 0;
+    }
+}
+
+b8 platformMutexLock(PlatformMutex* mutex) {
+    if (!mutex || !mutex->internalData) {
+        return false;
+    }
+    return pthread_mutex_lock(mutex->internalData) == 0;
+}
+
+b8 platformMutexUnlock(PlatformMutex* mutex) {
+    if (!mutex || !mutex->internalData) {
+        return false;
+    }
+    return pthread_mutex_unlock(mutex->internalData) == 0;
+}
+
 void platformConsoleWrite(const char* message, u8 color) {
     // FATAL,ERROR,WARN,INFO,DEBUG,TRACE
     const char* colorStrs[] = {"0;41", "1;31", "1;33", "1;32", "1;34", "1;30"};
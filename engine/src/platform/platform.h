@@ -14,12 +14,38 @@ void platformShutdown();
 
 b8 platformPumpMessages();
 
+// `aligned` gives a block aligned to PLATFORM_DEFAULT_ALIGNMENT
+#define PLATFORM_DEFAULT_ALIGNMENT 16
 void* platformAllocate(u64 size, b8 aligned);
+// `alignment` must be a power of 2. Free with `platformFree(block, true)`
+void* platformAllocateAligned(u64 size, u64 alignment);
 void platformFree(void* block, b8 aligned);
+// Maps whole pages straight from the OS. They are zeroed and only committed
+// when first touched.
+void* platformAllocatePages(u64 size);
+void platformFreePages(void* block, u64 size);
+// Reserves address space only. Nothing can be touched until it is committed
+void* platformReserveMemory(u64 size);
+// Makes part of a reserved range usable. `block` and `size` must be page
+// aligned.
+b8 platformCommitMemory(void* block, u64 size);
+// Gives a reserved range back to the OS, committed or not
+void platformReleaseMemory(void* block, u64 size);
+u64 platformGetPageSize();
 void* platformZeroMemory(void* block, u64 size);
 void* platformCopyMemory(void* dest, const void* src, u64 size);
 void* platformSetMemory(void* dest, i32 val, u64 size);
 
+// Holds a platform specific mutex
+typedef struct PlatformMutex {
+    void* internalData;
+} PlatformMutex;
+
+b8 platformMutexCreate(PlatformMutex* outMutex);
+void platformMutexDestroy(PlatformMutex* mutex);
+b8 platformMutexLock(PlatformMutex* mutex);
+b8 platformMutexUnlock(PlatformMutex* mutex);
+
 void platformConsoleWrite(const char* msg, u8 color);
 void platformConsoleWriteError(
     const char* msg,